@@ -0,0 +1,673 @@
+/*
+ * CSVDataModel.cpp: See "CSVDataModel.h" for documentation.
+ */
+
+#include "CSVDataModel.h"
+
+/* C includes. */
+#include <cmath>
+#include <cstring>
+
+/* C++ includes. */
+#include <algorithm>
+
+/* Qt includes. */
+#include <QThread>
+#include <QtConcurrent>
+
+// Rows per sorted run, at least; smaller inputs are sorted on one thread.
+static const int SortRunRows = 1 << 16;
+
+/*
+ * Struct: SortKey
+ * Description: Value reduced to an unsigned integer ordering as the value
+ *            : does, with its row as tie-breaker.
+ */
+struct SortKey
+{
+  quint64 key;
+  int row;
+
+  bool operator<(const SortKey &other) const
+  {
+    return (key < other.key) || ((key == other.key) && (row < other.row));
+  }
+};
+
+/*
+ * Struct: SortRun
+ * Description: Range of sorted keys, and the range it is merged with.
+ */
+struct SortRun
+{
+  int begin, end;
+  int nextEnd;
+};
+
+/*
+ * Procedure: sortKey
+ * Description: Maps a double to an integer of the same order: negative
+ *            : values have all bits flipped, others just the sign bit.
+ * Parameters: value: Value to map.
+ *           : descending: Whether to reverse the order.
+ * Returns: Key; NaN maps to the largest key in either order.
+ */
+static inline quint64 sortKey(double value, bool descending)
+{
+  if (value != value)
+    return ~quint64(0);
+
+  quint64 bits;
+  memcpy(&bits, &value, sizeof(bits));
+  bits = (bits >> 63) ? ~bits : (bits | (quint64(1) << 63));
+  return descending ? ~bits : bits;
+}
+
+/*
+ * Procedure: radixSort
+ * Description: Sorts keys by a stable least-significant-digit radix sort, so
+ *            : keys in row order stay in row order when equal.  Digits
+ *            : equal across all keys, such as the exponents of data in a
+ *            : narrow range, are skipped.
+ * Parameters: keys: Keys to sort.
+ *           : scratch: Buffer of count keys.
+ *           : count: Number of keys.
+ * Returns: none.
+ */
+static void radixSort(SortKey *keys, SortKey *scratch, int count)
+{
+  const int Bits = 11, Digits = (64 + Bits - 1) / Bits, Buckets = 1 << Bits;
+  if (count < 2)
+    return;
+
+  // Histograms of every digit, from one pass over the keys.
+  QVector<int> histogram(Digits * Buckets, 0);
+  int *counts = histogram.data();
+  for (int i = 0; i < count; i++)
+  {
+    quint64 key = keys[i].key;
+    for (int d = 0; d < Digits; d++)
+      counts[d * Buckets + int((key >> (d * Bits)) & (Buckets - 1))]++;
+  }
+
+  SortKey *from = keys, *to = scratch;
+  for (int d = 0; d < Digits; d++)
+  {
+    int *offsets = counts + d * Buckets;
+    if (offsets[int((from[0].key >> (d * Bits)) & (Buckets - 1))] == count)
+      continue;
+
+    int offset = 0;
+    for (int b = 0; b < Buckets; b++)
+    {
+      int n = offsets[b];
+      offsets[b] = offset;
+      offset += n;
+    }
+    for (int i = 0; i < count; i++)
+      to[offsets[int((from[i].key >> (d * Bits)) & (Buckets - 1))]++] =
+          from[i];
+    std::swap(from, to);
+  }
+
+  if (from != keys)
+    memcpy(keys, from, count * sizeof(SortKey));
+}
+
+/*
+ * Procedure: permuteColumn
+ * Description: Rebuilds a column in a new row order, encoding blocks as they
+ *            : fill; only this column is held decoded meanwhile.
+ * Parameters: column: Column to reorder.
+ *           : permutation: Row belonging at each position.
+ * Returns: none.
+ */
+static void permuteColumn(DataColumn &column, const QVector<int> &permutation)
+{
+  QVector<double> values(column.size());
+  column.read(0, values.size(), values.data());
+  column.clear();
+  for (int i = 0; i < permutation.size(); i++)
+    column.append(values.at(permutation.at(i)));
+  column.compact();
+}
+
+/*
+ * Constructor: CSVDataModel
+ */
+CSVDataModel::CSVDataModel(QObject *parent) :
+  QAbstractTableModel(parent),
+  xFormat(TimestampParser::None),
+  compact(false),
+  retainedRows(0),
+  modified(false)
+{
+}
+
+/*
+ * Method: rowCount
+ */
+int CSVDataModel::rowCount(const QModelIndex &parent) const
+{
+  return parent.isValid() ? 0 : xData.size();
+}
+
+/*
+ * Method: columnCount
+ */
+int CSVDataModel::columnCount(const QModelIndex &parent) const
+{
+  return parent.isValid() ? 0 : 2;
+}
+
+/*
+ * Method: data
+ */
+QVariant CSVDataModel::data(const QModelIndex &index, int role) const
+{
+  if (!index.isValid() ||
+      ((role != Qt::DisplayRole) && (role != Qt::EditRole)))
+    return QVariant();
+
+  const DataColumn &column = (index.column() == 0) ? xData : yData;
+  double value = column.value(index.row());
+
+  // Empty cells display as blank, but edit from zero.
+  if (value != value)
+    return (role == Qt::EditRole) ? QVariant(0.0) : QVariant();
+  if ((index.column() == 0) && (xFormat != TimestampParser::None))
+    return TimestampParser::toText(value);
+  return value;
+}
+
+/*
+ * Method: setData
+ */
+bool CSVDataModel::setData(const QModelIndex &index, const QVariant &value,
+                           int role)
+{
+  if (!index.isValid() || (role != Qt::EditRole))
+    return false;
+
+  double newValue = NAN;
+  if ((index.column() == 0) && (xFormat != TimestampParser::None) &&
+      (value.type() == QVariant::String) && !value.toString().isEmpty())
+  {
+    // Text left as shown keeps the value, including digits not shown.
+    if (value.toString() == TimestampParser::toText(xData.value(index.row())))
+      return true;
+
+    // Timestamps may be typed as ISO-8601 or in the file's own format.
+    QByteArray text = value.toString().toUtf8();
+    const char *begin = text.constData();
+    const char *end = begin + text.size();
+    if (!TimestampParser::parseIso8601(begin, end, &newValue) &&
+        !TimestampParser::parse(xFormat, begin, end, &newValue))
+      return false;
+  }
+  else if (!value.isNull() && !value.toString().isEmpty())
+  {
+    bool ok = false;
+    newValue = value.toDouble(&ok);
+    if (!ok)
+      return false;
+  }
+
+  DataColumn &column = (index.column() == 0) ? xData : yData;
+  column.setValue(index.row(), newValue);
+  modified = true;
+  emit dataChanged(index, index);
+  return true;
+}
+
+/*
+ * Method: headerData
+ */
+QVariant CSVDataModel::headerData(int section, Qt::Orientation orientation,
+                                  int role) const
+{
+  if ((orientation != Qt::Horizontal) ||
+      ((role != Qt::DisplayRole) && (role != Qt::EditRole)))
+    return QAbstractTableModel::headerData(section, orientation, role);
+
+  if (section == 0)
+    return xLabel;
+  if (section == 1)
+    return yLabel;
+  return QVariant();
+}
+
+/*
+ * Method: setHeaderData
+ */
+bool CSVDataModel::setHeaderData(int section, Qt::Orientation orientation,
+                                 const QVariant &value, int role)
+{
+  if ((orientation != Qt::Horizontal) || (role != Qt::EditRole) ||
+      (section < 0) || (section > 1))
+    return false;
+
+  if (section == 0)
+    xLabel = value.toString();
+  else
+    yLabel = value.toString();
+  modified = true;
+  emit headerDataChanged(orientation, section, section);
+  return true;
+}
+
+/*
+ * Method: flags
+ */
+Qt::ItemFlags CSVDataModel::flags(const QModelIndex &index) const
+{
+  if (!index.isValid())
+    return Qt::NoItemFlags;
+  return Qt::ItemIsSelectable | Qt::ItemIsEditable | Qt::ItemIsEnabled;
+}
+
+/*
+ * Method: insertRows
+ */
+bool CSVDataModel::insertRows(int row, int count, const QModelIndex &parent)
+{
+  if (parent.isValid() || (row < 0) || (row > rowCount()) || (count <= 0))
+    return false;
+
+  modified = true;
+  beginInsertRows(QModelIndex(), row, row + count - 1);
+  xData.insert(row, count, NAN);
+  yData.insert(row, count, NAN);
+  endInsertRows();
+  return true;
+}
+
+/*
+ * Method: removeRows
+ */
+bool CSVDataModel::removeRows(int row, int count, const QModelIndex &parent)
+{
+  if (parent.isValid() || (row < 0) || (count <= 0) ||
+      (row + count > rowCount()))
+    return false;
+
+  modified = true;
+  beginRemoveRows(QModelIndex(), row, row + count - 1);
+  xData.remove(row, count);
+  yData.remove(row, count);
+  endRemoveRows();
+  return true;
+}
+
+/*
+ * Method: insertRowRanges
+ */
+void CSVDataModel::insertRowRanges(
+    const QVector<DataColumn::RowRange> &ranges, const double *xs,
+    const double *ys)
+{
+  if (ranges.isEmpty())
+    return;
+
+  modified = true;
+  if (ranges.size() > SignalRanges)
+  {
+    beginResetModel();
+    xData.insertRanges(ranges, xs);
+    yData.insertRanges(ranges, ys);
+    if (compact)
+    {
+      xData.compact();
+      yData.compact();
+    }
+    endResetModel();
+    return;
+  }
+
+  // First run first: each is then at its final position once inserted.
+  int offset = 0;
+  for (int i = 0; i < ranges.size(); i++)
+  {
+    QVector<DataColumn::RowRange> range(1, ranges.at(i));
+    int row = ranges.at(i).row;
+    int count = ranges.at(i).count;
+    beginInsertRows(QModelIndex(), row, row + count - 1);
+    xData.insertRanges(range, xs ? xs + offset : 0);
+    yData.insertRanges(range, ys ? ys + offset : 0);
+    endInsertRows();
+    offset += count;
+  }
+
+  // Touched blocks are left raw; reseal them, as the reset above does.
+  if (compact)
+  {
+    xData.compact();
+    yData.compact();
+  }
+}
+
+/*
+ * Method: removeRowRanges
+ */
+void CSVDataModel::removeRowRanges(
+    const QVector<DataColumn::RowRange> &ranges, QVector<double> *xs,
+    QVector<double> *ys)
+{
+  int total = 0;
+  for (int i = 0; i < ranges.size(); i++)
+    total += ranges.at(i).count;
+  if (xs)
+    xs->resize(total);
+  if (ys)
+    ys->resize(total);
+  if (ranges.isEmpty())
+    return;
+
+  modified = true;
+  if (ranges.size() > SignalRanges)
+  {
+    beginResetModel();
+    xData.removeRanges(ranges, xs ? xs->data() : 0);
+    yData.removeRanges(ranges, ys ? ys->data() : 0);
+    if (compact)
+    {
+      xData.compact();
+      yData.compact();
+    }
+    endResetModel();
+    return;
+  }
+
+  // Last run first, so that earlier runs keep their rows.
+  int offset = total;
+  for (int i = ranges.size() - 1; i >= 0; i--)
+  {
+    int row = ranges.at(i).row;
+    int count = ranges.at(i).count;
+    offset -= count;
+    if (xs)
+      xData.read(row, count, xs->data() + offset);
+    if (ys)
+      yData.read(row, count, ys->data() + offset);
+
+    beginRemoveRows(QModelIndex(), row, row + count - 1);
+    xData.remove(row, count);
+    yData.remove(row, count);
+    endRemoveRows();
+  }
+
+  // Touched blocks are left raw; reseal them, as the reset above does.
+  if (compact)
+  {
+    xData.compact();
+    yData.compact();
+  }
+}
+
+/*
+ * Method: rowRanges
+ */
+QVector<DataColumn::RowRange> CSVDataModel::rowRanges(const QList<int> &rows)
+{
+  QVector<DataColumn::RowRange> ranges;
+  for (int i = 0; i < rows.size(); i++)
+  {
+    if (!ranges.isEmpty() &&
+        (ranges.last().row + ranges.last().count == rows.at(i)))
+    {
+      ranges.last().count++;
+    }
+    else
+    {
+      DataColumn::RowRange range;
+      range.row = rows.at(i);
+      range.count = 1;
+      ranges.append(range);
+    }
+  }
+  return ranges;
+}
+
+/*
+ * Method: appendRows
+ */
+void CSVDataModel::appendRows(const double *xs, const double *ys, int count)
+{
+  if (count <= 0)
+    return;
+
+  // Rows that would be evicted straight away are never stored.
+  if ((retainedRows > 0) && (count > retainedRows))
+  {
+    xs += count - retainedRows;
+    ys += count - retainedRows;
+    count = retainedRows;
+  }
+
+  int evicted = (retainedRows > 0) ?
+      qMax(0, rowCount() + count - retainedRows) : 0;
+  if (evicted > 0)
+    removeRows(0, evicted);
+
+  int first = rowCount();
+  modified = true;
+  beginInsertRows(QModelIndex(), first, first + count - 1);
+  for (int i = 0; i < count; i++)
+  {
+    xData.append(xs[i]);
+    yData.append(ys[i]);
+  }
+  endInsertRows();
+}
+
+/*
+ * Method: setRetention
+ */
+void CSVDataModel::setRetention(int rows)
+{
+  retainedRows = qMax(0, rows);
+  if ((retainedRows > 0) && (rowCount() > retainedRows))
+    removeRows(0, rowCount() - retainedRows);
+}
+
+/*
+ * Method: sort
+ */
+void CSVDataModel::sort(int column, Qt::SortOrder order)
+{
+  int rows = rowCount();
+  if ((column < 0) || (column > 1) || (rows < 2))
+    return;
+
+  QVector<int> permutation = sortPermutation((column == 0) ? xData : yData,
+                                             order);
+  modified = true;
+
+  emit layoutAboutToBeChanged(QList<QPersistentModelIndex>(),
+                              QAbstractItemModel::VerticalSortHint);
+
+  // Rebuild the columns in the new order, one after the other.
+  permuteColumn(xData, permutation);
+  permuteColumn(yData, permutation);
+
+  QModelIndexList from = persistentIndexList();
+  if (!from.isEmpty())
+  {
+    QVector<int> position(rows);
+    for (int i = 0; i < rows; i++)
+      position[permutation.at(i)] = i;
+
+    QModelIndexList to;
+    for (int i = 0; i < from.size(); i++)
+      to.append(index(position.at(from.at(i).row()), from.at(i).column()));
+    changePersistentIndexList(from, to);
+  }
+  permutation = QVector<int>();
+
+  emit layoutChanged(QList<QPersistentModelIndex>(),
+                     QAbstractItemModel::VerticalSortHint);
+}
+
+/*
+ * Method: sortPermutation
+ */
+QVector<int> CSVDataModel::sortPermutation(const DataColumn &column,
+                                           Qt::SortOrder order)
+{
+  int count = column.size();
+  bool descending = (order == Qt::DescendingOrder);
+  QVector<SortKey> keys(count), buffer(count);
+  SortKey *source = keys.data();
+  SortKey *destination = buffer.data();
+
+  // Key the values block by block, decoding compact blocks as they are read.
+  QVector<int> blocks;
+  for (int b = 0; b < column.blockCount(); b++)
+    blocks.append(b);
+  QtConcurrent::blockingMap(blocks, [&column, source, descending](int &b)
+  {
+    QVector<double> scratch(DataColumn::MaxBlockSize);
+    const double *data = column.blockData(b, scratch.data());
+    int start = column.blockStart(b);
+    for (int i = 0; i < column.blockLength(b); i++)
+    {
+      source[start + i].key = sortKey(data[i], descending);
+      source[start + i].row = start + i;
+    }
+  });
+
+  // Sort one run per thread.
+  int parts = qBound(1, QThread::idealThreadCount(),
+                     qMax(1, count / SortRunRows));
+  QVector<SortRun> runs;
+  for (int p = 0; p < parts; p++)
+  {
+    SortRun run;
+    run.begin = int(qint64(count) * p / parts);
+    run.end = int(qint64(count) * (p + 1) / parts);
+    run.nextEnd = run.end;
+    runs.append(run);
+  }
+  QtConcurrent::blockingMap(runs, [source, destination](SortRun &run)
+  {
+    radixSort(source + run.begin, destination + run.begin,
+              run.end - run.begin);
+  });
+
+  // Merge neighbouring runs until one remains; an odd run is copied.
+  while (runs.size() > 1)
+  {
+    QVector<SortRun> merges;
+    for (int r = 0; r < runs.size(); r += 2)
+    {
+      SortRun merge = runs.at(r);
+      merge.nextEnd = (r + 1 < runs.size()) ? runs.at(r + 1).end : merge.end;
+      merges.append(merge);
+    }
+    QtConcurrent::blockingMap(merges, [source, destination](SortRun &merge)
+    {
+      std::merge(source + merge.begin, source + merge.end,
+                 source + merge.end, source + merge.nextEnd,
+                 destination + merge.begin);
+      merge.end = merge.nextEnd;
+    });
+    std::swap(source, destination);
+    runs = merges;
+  }
+
+  QVector<int> permutation(count);
+  for (int i = 0; i < count; i++)
+    permutation[i] = source[i].row;
+  return permutation;
+}
+
+/*
+ * Method: setDataSet
+ */
+void CSVDataModel::setDataSet(const CSVDataSet &dataSet)
+{
+  beginResetModel();
+  xLabel = dataSet.xLabel;
+  yLabel = dataSet.yLabel;
+  xData = dataSet.xData;
+  yData = dataSet.yData;
+  xFormat = dataSet.xTimeFormat;
+  errorLog = dataSet.parseLog;
+  modified = false;
+
+  // Match the current storage setting; cheap if the parser already did.
+  xData.setCompaction(compact, 0.0);
+  yData.setCompaction(compact, DataColumn::DefaultTolerance);
+  endResetModel();
+}
+
+/*
+ * Method: dataSet
+ */
+CSVDataSet CSVDataModel::dataSet() const
+{
+  CSVDataSet dataSet;
+  dataSet.xLabel = xLabel;
+  dataSet.yLabel = yLabel;
+  dataSet.xData = xData;
+  dataSet.yData = yData;
+  dataSet.xTimeFormat = xFormat;
+  dataSet.parseLog = errorLog;
+  return dataSet;
+}
+
+/*
+ * Method: fileText
+ */
+QString CSVDataModel::fileText(int row, int column) const
+{
+  double value = (column == 0) ? xData.value(row) : yData.value(row);
+  if (value != value)
+    return QString();
+
+  if (column == 0)
+  {
+    switch (xFormat)
+    {
+      case TimestampParser::Iso8601:
+        return TimestampParser::toText(value);
+      case TimestampParser::EpochMilliseconds:
+      {
+        // Undo the division by 1000 made when reading.
+        double milliseconds = value * 1000.0;
+        double whole = std::floor(milliseconds + 0.5);
+        if (std::fabs(milliseconds - whole) < 1e-3)
+          return QString::number(qint64(whole));
+        return QString::number(milliseconds, 'g', 17);
+      }
+      default:
+        break;
+    }
+  }
+  return QVariant(value).toString();
+}
+
+/*
+ * Method: setCompactStorage
+ */
+void CSVDataModel::setCompactStorage(bool compact)
+{
+  if (this->compact == compact)
+    return;
+
+  this->compact = compact;
+  xData.setCompaction(compact, 0.0);
+  yData.setCompaction(compact, DataColumn::DefaultTolerance);
+
+  // Narrowing may have changed Y values slightly.
+  if (rowCount() > 0)
+    emit dataChanged(index(0, 1), index(rowCount() - 1, 1));
+}
+
+/*
+ * Method: memoryUsage
+ */
+qint64 CSVDataModel::memoryUsage() const
+{
+  return xData.memoryUsage() + yData.memoryUsage();
+}
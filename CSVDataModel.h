@@ -0,0 +1,292 @@
+/*
+ * CSVDataModel.h: Two-column table model over block-structured column
+ *               : storage.
+ * Author: B. D. Knopp: bdknopp@users.noreply.github.com
+ * Version: 1.00: Initial implementation; replaces QStandardItemModel.
+ * Date: 19 October 2026
+ */
+
+#ifndef CSVDATAMODEL_H
+#define CSVDATAMODEL_H
+
+/* Qt includes. */
+#include <QAbstractTableModel>
+#include <QList>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+/* Project includes. */
+#include "CSVParser.h"
+#include "DataColumn.h"
+
+/*
+ * Class: CSVDataModel
+ * Description: Table model holding the X (column 0) and Y (column 1) data of
+ *            : a CSV file in DataColumns rather than per-cell items.  Empty
+ *            : cells, such as those of newly inserted rows, are stored as
+ *            : NaN.  Views needing bulk access read the columns directly.
+ */
+class CSVDataModel : public QAbstractTableModel
+{
+  Q_OBJECT
+
+  /* Public types. */
+  public:
+    // Batches of more row ranges than this reset the model once, rather
+    // than announce each range to views.
+    static const int SignalRanges = 16;
+
+  /* Public methods. */
+  public:
+    /*
+     * Constructor: CSVDataModel
+     * Description: Creates an empty model with compaction disabled.
+     * Parameters: parent: Parent object to associate with; default 0.
+     */
+    explicit CSVDataModel(QObject *parent = 0);
+
+    /*
+     * Methods: rowCount, columnCount
+     * Description: Retrieves the table dimensions.
+     * Parameters: parent: Parent index; must be invalid.
+     * Returns: Number of rows or columns.
+     */
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+
+    /*
+     * Method: data
+     * Description: Retrieves the value of a cell.
+     * Parameters: index: Cell to retrieve.
+     *           : role: Display or edit role.
+     * Returns: Value as a double; invalid for empty cells when displayed.
+     */
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+    /*
+     * Method: setData
+     * Description: Replaces the value of a cell.
+     * Parameters: index: Cell to modify.
+     *           : value: New value; an empty value clears the cell.
+     *           : role: Edit role.
+     * Returns: True if the value was accepted; false otherwise.
+     */
+    bool setData(const QModelIndex &index, const QVariant &value,
+                 int role = Qt::EditRole);
+
+    /*
+     * Methods: headerData, setHeaderData
+     * Description: Retrieves or replaces a column label.
+     * Parameters: section: Column number.
+     *           : orientation: Horizontal for column labels.
+     *           : value: New label.
+     *           : role: Display or edit role.
+     * Returns: Label; or true if the label was replaced.
+     */
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const;
+    bool setHeaderData(int section, Qt::Orientation orientation,
+                       const QVariant &value, int role = Qt::EditRole);
+
+    /*
+     * Method: flags
+     * Description: Determines the item flags of a cell; all are editable.
+     * Parameters: index: Cell to query.
+     * Returns: Item flags.
+     */
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+
+    /*
+     * Methods: insertRows, removeRows
+     * Description: Inserts empty rows or removes rows.
+     * Parameters: row: First row affected.
+     *           : count: Number of rows.
+     *           : parent: Parent index; must be invalid.
+     * Returns: True if successful; false otherwise.
+     */
+    bool insertRows(int row, int count,
+                    const QModelIndex &parent = QModelIndex());
+    bool removeRows(int row, int count,
+                    const QModelIndex &parent = QModelIndex());
+
+    /*
+     * Method: insertRowRanges
+     * Description: Inserts several runs of rows as one operation, in one
+     *            : pass over the columns.
+     * Parameters: ranges: Disjoint runs in ascending order, giving the rows
+     *           :       : they occupy once inserted.
+     *           : xs, ys: Values of the inserted rows in row order; 0 to
+     *           :       : insert empty cells.
+     * Returns: none.
+     */
+    void insertRowRanges(const QVector<DataColumn::RowRange> &ranges,
+                         const double *xs = 0, const double *ys = 0);
+
+    /*
+     * Method: removeRowRanges
+     * Description: Removes several runs of rows as one operation, in one
+     *            : pass over the columns.
+     * Parameters: ranges: Disjoint runs in ascending order.
+     *           : xs, ys: Receive the values removed in row order; may be
+     *           :       : 0.
+     * Returns: none.
+     */
+    void removeRowRanges(const QVector<DataColumn::RowRange> &ranges,
+                         QVector<double> *xs = 0, QVector<double> *ys = 0);
+
+    /*
+     * Method: rowRanges
+     * Description: Coalesces rows into runs of consecutive rows.
+     * Parameters: rows: Distinct rows in ascending order.
+     * Returns: Runs in ascending order.
+     */
+    static QVector<DataColumn::RowRange> rowRanges(const QList<int> &rows);
+
+    /*
+     * Method: appendRows
+     * Description: Appends rows as one insertion.  When a retention limit
+     *            : is set, the oldest rows beyond it are first removed as
+     *            : one removal, so the model holds a sliding window.
+     * Parameters: xs, ys: Values of each row.
+     *           : count: Number of rows.
+     * Returns: none.
+     */
+    void appendRows(const double *xs, const double *ys, int count);
+
+    /*
+     * Methods: setRetention, retention
+     * Description: Replaces or retrieves the most rows appendRows keeps.
+     *            : Lowering the limit removes the oldest rows at once.
+     * Parameters: rows: Row limit; 0 for no limit.
+     * Returns: none; or the row limit.
+     */
+    void setRetention(int rows);
+    int retention() const { return retainedRows; }
+
+    /*
+     * Method: sort
+     * Description: Sorts the rows by a column, as one layout change.  The
+     *            : order is found by a parallel sort of keys read from the
+     *            : column's blocks; each column is then rebuilt through it
+     *            : in turn, so only one is held decoded at a time.  Empty
+     *            : cells sort last; equal values keep their order.
+     * Parameters: column: Column to sort by.
+     *           : order: Ascending or descending.
+     * Returns: none.
+     */
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+    /*
+     * Method: sortPermutation
+     * Description: Finds the stable sorted order of a column's values,
+     *            : radix sorting runs on separate threads and merging them
+     *            : pairwise in parallel.
+     * Parameters: column: Values to order.
+     *           : order: Ascending or descending; NaN always sorts last.
+     * Returns: Index of the value belonging at each position.
+     */
+    static QVector<int> sortPermutation(const DataColumn &column,
+                                        Qt::SortOrder order);
+
+    /*
+     * Method: setDataSet
+     * Description: Replaces the model contents with a parsed data set.
+     * Parameters: dataSet: Labels and columns to take.
+     * Returns: none.
+     */
+    void setDataSet(const CSVDataSet &dataSet);
+
+    /*
+     * Method: dataSet
+     * Description: Retrieves the model contents, sharing the columns.
+     * Parameters: none.
+     * Returns: Labels and columns.
+     */
+    CSVDataSet dataSet() const;
+
+    /*
+     * Method: xTimeFormat
+     * Description: Retrieves the timestamp format of the X column.  X values
+     *            : of timestamp columns are seconds since the epoch, shown
+     *            : and edited as ISO-8601 text.
+     * Parameters: none.
+     * Returns: Timestamp format; None for plain numbers.
+     */
+    TimestampParser::Format xTimeFormat() const { return xFormat; }
+
+    /*
+     * Method: parseLog
+     * Description: Retrieves the problems found parsing the data set shown.
+     *            : Rows are those of the data set as parsed.
+     * Parameters: none.
+     * Returns: Parse log; empty if none.
+     */
+    const CSVParseLog &parseLog() const { return errorLog; }
+
+    /*
+     * Method: isModified
+     * Description: Determines if the contents have changed since the last
+     *            : setDataSet.
+     * Parameters: none.
+     * Returns: True if modified; false otherwise.
+     */
+    bool isModified() const { return modified; }
+
+    /*
+     * Method: fileText
+     * Description: Formats a cell as it should be written to a CSV file,
+     *            : keeping the X column's timestamp format; ISO-8601
+     *            : times are written in UTC, to the microsecond.
+     * Parameters: row, column: Cell to format.
+     * Returns: Cell text; empty for empty cells.
+     */
+    QString fileText(int row, int column) const;
+
+    /*
+     * Method: setCompactStorage
+     * Description: Enables or disables compact column encodings.  Y values
+     *            : may be narrowed to float32 within DataColumn's default
+     *            : tolerance; X values are only ever encoded losslessly.
+     * Parameters: compact: Whether to use compact encodings.
+     * Returns: none.
+     */
+    void setCompactStorage(bool compact);
+
+    /*
+     * Method: compactStorage
+     * Description: Determines if compact encodings are enabled.
+     * Parameters: none.
+     * Returns: True if enabled; false otherwise.
+     */
+    bool compactStorage() const { return compact; }
+
+    /*
+     * Method: memoryUsage
+     * Description: Estimates the memory held by the data columns.
+     * Parameters: none.
+     * Returns: Size in bytes.
+     */
+    qint64 memoryUsage() const;
+
+    /*
+     * Methods: xColumn, yColumn
+     * Description: Retrieves the column storage for bulk readers.
+     * Parameters: none.
+     * Returns: X or Y column.
+     */
+    const DataColumn &xColumn() const { return xData; }
+    const DataColumn &yColumn() const { return yData; }
+
+  /* Private members. */
+  private:
+    QString xLabel, yLabel;
+    DataColumn xData, yData;
+    TimestampParser::Format xFormat;
+    CSVParseLog errorLog;
+    bool compact;
+    int retainedRows;
+    bool modified;
+};
+
+#endif // CSVDATAMODEL_H
@@ -9,11 +9,19 @@
 #ifndef CSVFILEEXCEPTION_H
 #define CSVFILEEXCEPTION_H
 
+/* C++ includes. */
+#include <string>
+
+/* Qt includes. */
+#include <QException>
+
 /*
  * Class: CSVFileException
- * Description: Exception class for reading/writing CSV files.
+ * Description: Exception class for reading/writing CSV files.  Derives from
+ *            : QException so that a file parsed by QtConcurrent rethrows
+ *            : it from QFuture::result() on the thread reading the result.
  */
-class CSVFileException : public std::exception
+class CSVFileException : public QException
 {
   /* Public methods. */
   public:
@@ -38,6 +46,15 @@ class CSVFileException : public std::exception
      */
     const char* what() const throw() { return msg.c_str(); }
 
+    /*
+     * Methods: raise, clone
+     * Description: Rethrow or copy the exception across threads.
+     * Parameters: none.
+     * Returns: none; or a copy allocated with new.
+     */
+    void raise() const { throw *this; }
+    CSVFileException *clone() const { return new CSVFileException(*this); }
+
   /* Private members. */
   private:
     std::string msg;
@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui concurrent network svg
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -14,10 +14,40 @@ TEMPLATE = app
 
 SOURCES += main.cpp\
         MainWindow.cpp \
-    LineGraphView.cpp
+    LineGraphView.cpp \
+    CSVParser.cpp \
+    DecompressionStage.cpp \
+    CompressedFileWriter.cpp \
+    DataColumn.cpp \
+    CSVDataModel.cpp \
+    TimestampParser.cpp \
+    DerivedSeries.cpp \
+    RowFilterProxyModel.cpp \
+    LiveIngestServer.cpp \
+    DatasetCache.cpp \
+    RowRangeCommand.cpp
 
 HEADERS  += MainWindow.h \
     CSVFileException.h \
-    LineGraphView.h
+    LineGraphView.h \
+    CSVParser.h \
+    DecompressionStage.h \
+    CompressedFileWriter.h \
+    DataColumn.h \
+    CSVDataModel.h \
+    TimestampParser.h \
+    DerivedSeries.h \
+    RowFilterProxyModel.h \
+    LiveIngestProtocol.h \
+    LiveIngestServer.h \
+    DatasetCache.h \
+    RowRangeCommand.h
 
 FORMS    += MainWindow.ui
+
+# Compressed input and output: zlib is required, zstd is used when available.
+LIBS += -lz
+packagesExist(libzstd) {
+  DEFINES += HAVE_ZSTD
+  LIBS += -lzstd
+}
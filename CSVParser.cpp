@@ -0,0 +1,430 @@
+/*
+ * CSVParser.cpp: See "CSVParser.h" for documentation.
+ */
+
+#include "CSVParser.h"
+#include "DecompressionStage.h"
+
+/* C includes. */
+#include <cmath>
+#include <cstring>
+
+/* Qt includes. */
+#include <QStringList>
+
+// Powers of ten exactly representable as doubles.
+static const double exactPowers[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*
+ * Procedure: isBlank
+ * Description: Determines if character is a space or tab.
+ * Parameters: c: Character to test.
+ * Returns: True if blank; false otherwise.
+ */
+static inline bool isBlank(char c)
+{
+  return (c == ' ') || (c == '\t');
+}
+
+/*
+ * Procedure: isEmptyField
+ * Description: Determines if a field holds nothing but blanks.
+ * Parameters: begin, end: Field text.
+ * Returns: True if empty; false otherwise.
+ */
+static bool isEmptyField(const char *begin, const char *end)
+{
+  while ((begin < end) && isBlank(*begin))
+    begin++;
+  return begin == end;
+}
+
+/*
+ * Constructor: CSVParser
+ */
+CSVParser::CSVParser(QString fName) :
+  fileName(fName),
+  errorMode(FillNaN),
+  bytesFed(0),
+  lineNumber(0),
+  lineOffset(0),
+  partialOffset(0),
+  headerRead(false),
+  formatDetected(false)
+{
+}
+
+/*
+ * Method: setCompactStorage
+ */
+void CSVParser::setCompactStorage(bool compact)
+{
+  data.xData.setCompaction(compact, 0.0);
+  data.yData.setCompaction(compact, DataColumn::DefaultTolerance);
+}
+
+/*
+ * Method: setErrorMode
+ */
+void CSVParser::setErrorMode(ErrorMode mode)
+{
+  errorMode = mode;
+}
+
+/*
+ * Method: feed
+ */
+void CSVParser::feed(const char *data, int length) throw(CSVFileException)
+{
+  const char *pos = data;
+  const char *end = data + length;
+  qint64 base = bytesFed;
+  bytesFed += length;
+
+  // Complete any line carried over from the previous chunk.
+  if (!partialLine.isEmpty())
+  {
+    const char *newline =
+        static_cast<const char*>(memchr(pos, '\n', end - pos));
+    if (!newline)
+    {
+      partialLine.append(pos, int(end - pos));
+      return;
+    }
+
+    partialLine.append(pos, int(newline - pos));
+    lineOffset = partialOffset;
+    parseLine(partialLine.constData(),
+              partialLine.constData() + partialLine.size());
+    partialLine.resize(0);
+    pos = newline + 1;
+  }
+
+  // Parse whole lines directly from the chunk.
+  while (pos < end)
+  {
+    const char *newline =
+        static_cast<const char*>(memchr(pos, '\n', end - pos));
+    if (!newline)
+    {
+      partialOffset = base + (pos - data);
+      partialLine.append(pos, int(end - pos));
+      break;
+    }
+
+    lineOffset = base + (pos - data);
+    parseLine(pos, newline);
+    pos = newline + 1;
+  }
+}
+
+/*
+ * Method: finish
+ */
+void CSVParser::finish() throw(CSVFileException)
+{
+  if (!partialLine.isEmpty())
+  {
+    lineOffset = partialOffset;
+    parseLine(partialLine.constData(),
+              partialLine.constData() + partialLine.size());
+    partialLine.resize(0);
+  }
+
+  // Encode the final, partially filled blocks.
+  data.xData.compact();
+  data.yData.compact();
+}
+
+/*
+ * Method: parseFile
+ */
+CSVDataSet CSVParser::parseFile(QString fName, bool compact, ErrorMode mode)
+    throw(CSVFileException)
+{
+  DecompressionStage stage(fName);
+  stage.open();
+  stage.start();
+
+  // The stage's destructor stops the worker if parsing throws.
+  CSVParser parser(fName);
+  parser.setCompactStorage(compact);
+  parser.setErrorMode(mode);
+  const DecompressionStage::Chunk *chunk;
+  while ((chunk = stage.nextChunk()) != 0)
+  {
+    parser.feed(chunk->buffer.constData(), chunk->length);
+    stage.releaseChunk(chunk);
+  }
+  parser.finish();
+
+  return parser.dataSet();
+}
+
+/*
+ * Method: errorDescription
+ */
+const char *CSVParser::errorDescription(int kind)
+{
+  switch (kind)
+  {
+    case CSVParseError::HeaderFields:
+      return "header does not name two columns";
+    case CSVParseError::MissingField:
+      return "line has one field, not two";
+    case CSVParseError::ExtraFields:
+      return "line has more than two fields; extra fields ignored";
+    case CSVParseError::InvalidX:
+      return "X value is not valid";
+    case CSVParseError::InvalidY:
+      return "Y value is not valid";
+    default:
+      return "line is not valid";
+  }
+}
+
+/*
+ * Method: parseNumber
+ */
+bool CSVParser::parseNumber(const char *begin, const char *end, double *value)
+{
+  while ((begin < end) && isBlank(*begin))
+    begin++;
+  while ((end > begin) && isBlank(end[-1]))
+    end--;
+  if (begin == end)
+    return false;
+
+  // Accumulate up to 19 significant digits into an integer mantissa.
+  const char *p = begin;
+  bool negative = false;
+  if ((*p == '-') || (*p == '+'))
+  {
+    negative = (*p == '-');
+    p++;
+  }
+
+  quint64 mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool anyDigits = false;
+  bool truncated = false;
+
+  while ((p < end) && (*p >= '0') && (*p <= '9'))
+  {
+    if (digits < 19)
+    {
+      mantissa = mantissa * 10 + (*p - '0');
+      if (mantissa)
+        digits++;
+    }
+    else
+    {
+      exponent++;
+      truncated = truncated || (*p != '0');
+    }
+    anyDigits = true;
+    p++;
+  }
+
+  if ((p < end) && (*p == '.'))
+  {
+    p++;
+    while ((p < end) && (*p >= '0') && (*p <= '9'))
+    {
+      if (digits < 19)
+      {
+        mantissa = mantissa * 10 + (*p - '0');
+        if (mantissa)
+          digits++;
+        exponent--;
+      }
+      else
+      {
+        truncated = truncated || (*p != '0');
+      }
+      anyDigits = true;
+      p++;
+    }
+  }
+
+  if (anyDigits && (p < end) && ((*p == 'e') || (*p == 'E')))
+  {
+    const char *expStart = p++;
+    bool expNegative = false;
+    if ((p < end) && ((*p == '-') || (*p == '+')))
+    {
+      expNegative = (*p == '-');
+      p++;
+    }
+
+    int expValue = 0;
+    bool expDigits = false;
+    while ((p < end) && (*p >= '0') && (*p <= '9'))
+    {
+      if (expValue < 100000)
+        expValue = expValue * 10 + (*p - '0');
+      expDigits = true;
+      p++;
+    }
+
+    if (expDigits)
+      exponent += expNegative ? -expValue : expValue;
+    else
+      p = expStart;
+  }
+
+  // Exact fast path: mantissa and power of ten are both exact doubles, so a
+  // single multiply or divide is correctly rounded.
+  if (anyDigits && (p == end) && !truncated)
+  {
+    if (mantissa == 0)
+    {
+      *value = negative ? -0.0 : 0.0;
+      return true;
+    }
+
+    if ((digits <= 15) && (exponent >= -22) && (exponent <= 22))
+    {
+      double result = double(mantissa);
+      if (exponent < 0)
+        result /= exactPowers[-exponent];
+      else
+        result *= exactPowers[exponent];
+      *value = negative ? -result : result;
+      return true;
+    }
+  }
+
+  // Rare cases (long mantissas, large exponents, inf, nan): slow path.
+  bool ok = false;
+  *value = QByteArray::fromRawData(begin, int(end - begin)).toDouble(&ok);
+  return ok;
+}
+
+/*
+ * Method: parseLine
+ */
+void CSVParser::parseLine(const char *begin, const char *end)
+    throw(CSVFileException)
+{
+  lineNumber++;
+  if ((end > begin) && (end[-1] == '\r'))
+    end--;
+
+  // Read header information on first line.
+  if (!headerRead)
+  {
+    if ((end - begin >= 3) && (memcmp(begin, "\xef\xbb\xbf", 3) == 0))
+      begin += 3;
+
+    QString header = QString::fromUtf8(begin, int(end - begin));
+    QStringList labels = header.split(",");
+
+    // Error if more or less than two columns; leniently, take the first two.
+    if (labels.size() != 2)
+    {
+      reportError(CSVParseError::HeaderFields);
+      while (labels.size() < 2)
+        labels.append(QString());
+    }
+
+    data.xLabel = labels.at(0);
+    data.yLabel = labels.at(1);
+    headerRead = true;
+    return;
+  }
+
+  if (begin == end)
+    return;
+
+  // Split on the first comma.
+  const char *comma = static_cast<const char*>(memchr(begin, ',', end - begin));
+  const char *xEnd = comma ? comma : end;
+
+  // The first valid X value fixes the X format for the rest of the file;
+  //   blank or malformed values before it are read as plain numbers.
+  if (!formatDetected)
+  {
+    double probe;
+    data.xTimeFormat = TimestampParser::detectFormat(data.xLabel, begin, xEnd);
+    formatDetected = (data.xTimeFormat != TimestampParser::None) ||
+        parseNumber(begin, xEnd, &probe);
+  }
+
+  // Validation costs nothing on valid lines: fields are examined further
+  //   only once they have failed to parse.  Empty fields read as NaN.
+  double x, y;
+  int kind = -1;
+  bool extra = false;
+  if (!TimestampParser::parse(data.xTimeFormat, begin, xEnd, &x))
+  {
+    x = NAN;
+    if (!isEmptyField(begin, xEnd))
+      kind = CSVParseError::InvalidX;
+  }
+  if (!comma)
+  {
+    y = NAN;
+    kind = CSVParseError::MissingField;
+  }
+  else if (!parseNumber(comma + 1, end, &y))
+  {
+    // Fields past the second are ignored; Y is read up to them.
+    const char *yEnd = static_cast<const char*>(
+        memchr(comma + 1, ',', end - comma - 1));
+    extra = (yEnd != 0);
+    if (!extra)
+      yEnd = end;
+    if (!extra || !parseNumber(comma + 1, yEnd, &y))
+    {
+      y = NAN;
+      if ((kind < 0) && !isEmptyField(comma + 1, yEnd))
+        kind = CSVParseError::InvalidY;
+    }
+  }
+
+  // Extra fields alone are a warning: the line is kept in every mode.
+  if (kind >= 0)
+  {
+    reportError(kind);
+    if (errorMode == SkipRows)
+      return;
+  }
+  else if (extra)
+  {
+    reportError(CSVParseError::ExtraFields);
+  }
+
+  data.xData.append(x);
+  data.yData.append(y);
+}
+
+/*
+ * Method: reportError
+ */
+void CSVParser::reportError(int kind) throw(CSVFileException)
+{
+  if ((errorMode == Strict) && (kind != CSVParseError::ExtraFields))
+  {
+    QString msg = QString("File \"%1\" incorrectly formatted at line %2 "
+                          "(byte %3): %4.").arg(fileName).arg(lineNumber)
+        .arg(lineOffset).arg(errorDescription(kind));
+    throw CSVFileException(msg.toStdString());
+  }
+
+  CSVParseLog &log = data.parseLog;
+  log.count++;
+  if (log.errors.size() < MaxLoggedErrors)
+  {
+    CSVParseError error;
+    error.line = lineNumber;
+    error.offset = lineOffset;
+    error.row = data.xData.size();
+    error.kind = kind;
+    log.errors.append(error);
+  }
+}
@@ -0,0 +1,214 @@
+/*
+ * CSVParser.h: Incremental two-column CSV parser; consumes raw file contents
+ *            : chunk by chunk, without building intermediate strings.
+ * Author: B. D. Knopp: bdknopp@users.noreply.github.com
+ * Version: 1.00: Initial implementation.
+ * Date: 19 October 2026
+ */
+
+#ifndef CSVPARSER_H
+#define CSVPARSER_H
+
+/* C++ includes. */
+#include <exception>
+#include <string>
+
+/* Qt includes. */
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+/* Project includes. */
+#include "CSVFileException.h"
+#include "DataColumn.h"
+#include "TimestampParser.h"
+
+/*
+ * Struct: CSVParseError
+ * Description: A line of a CSV file that could not be read as written.
+ *            : ExtraFields is only a warning: the line is read from its
+ *            : first two fields.
+ */
+struct CSVParseError
+{
+  enum Kind { HeaderFields, MissingField, ExtraFields, InvalidX, InvalidY };
+
+  // Line number, from 1; byte offset of the line's start in the
+  // decompressed text.
+  qint64 line, offset;
+
+  // Row of the data set holding the line, or following it if skipped.
+  int row;
+  int kind;
+};
+
+/*
+ * Struct: CSVParseLog
+ * Description: Problems found while parsing; only the first are listed,
+ *            : but all are counted.
+ */
+struct CSVParseLog
+{
+  CSVParseLog() : count(0) { }
+
+  QVector<CSVParseError> errors;
+  qint64 count;
+};
+
+/*
+ * Struct: CSVDataSet
+ * Description: Parsed contents of a two-column CSV file.  Timestamp X values
+ *            : are held as seconds since the epoch.
+ */
+struct CSVDataSet
+{
+  CSVDataSet() : xTimeFormat(TimestampParser::None) { }
+
+  QString xLabel, yLabel;
+  DataColumn xData, yData;
+  TimestampParser::Format xTimeFormat;
+  CSVParseLog parseLog;
+};
+
+/*
+ * Class: CSVParser
+ * Description: Parses a header line followed by "x,y" data lines.  Input may
+ *            : be split across chunks at any byte; complete lines are parsed
+ *            : in place and only a line straddling two chunks is copied.
+ */
+class CSVParser
+{
+  /* Public types. */
+  public:
+    /*
+     * Enum: ErrorMode
+     * Description: Handling of malformed lines: fail at the first; skip
+     *            : them; or keep them, with invalid or missing cells empty
+     *            : (NaN).  Lenient modes log each line and go on.
+     */
+    enum ErrorMode { Strict, SkipRows, FillNaN };
+
+    // Problems listed in a parse log, at most.
+    static const int MaxLoggedErrors = 10000;
+
+  /* Public methods. */
+  public:
+    /*
+     * Constructor: CSVParser
+     * Description: Creates a parser expecting a header line first.
+     * Parameters: fName: File name, used in error messages.
+     */
+    explicit CSVParser(QString fName);
+
+    /*
+     * Method: setCompactStorage
+     * Description: Enables compact column encodings; blocks are encoded as
+     *            : they fill, so the raw data is never held in full.
+     * Parameters: compact: Whether to use compact encodings.
+     * Returns: none.
+     */
+    void setCompactStorage(bool compact);
+
+    /*
+     * Method: setErrorMode
+     * Description: Selects the handling of malformed lines.  Empty cells
+     *            : are read as NaN and are not errors.
+     * Parameters: mode: Error handling mode; FillNaN by default.
+     * Returns: none.
+     */
+    void setErrorMode(ErrorMode mode);
+
+    /*
+     * Method: feed
+     * Description: Parses the next chunk of file contents.
+     * Parameters: data: Start of chunk.
+     *           : length: Number of bytes in chunk.
+     * Returns: none.
+     */
+    void feed(const char *data, int length) throw(CSVFileException);
+
+    /*
+     * Method: finish
+     * Description: Parses any final line lacking a line terminator.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void finish() throw(CSVFileException);
+
+    /*
+     * Method: dataSet
+     * Description: Retrieves the data parsed so far.
+     * Parameters: none.
+     * Returns: Parsed data set.
+     */
+    CSVDataSet &dataSet() { return data; }
+
+    /*
+     * Method: parseFile
+     * Description: Reads and parses the named CSV file, which may be gzip or
+     *            : zstd compressed.  Decompression runs on a separate thread,
+     *            : overlapped with parsing.
+     * Parameters: fName: Name of CSV file to read.
+     *           : compact: Whether to use compact column encodings.
+     *           : mode: Handling of malformed lines.
+     * Returns: Parsed data set.
+     */
+    static CSVDataSet parseFile(QString fName, bool compact = false,
+                                ErrorMode mode = FillNaN)
+        throw(CSVFileException);
+
+    /*
+     * Method: errorDescription
+     * Description: Describes a kind of parse error.
+     * Parameters: kind: CSVParseError::Kind.
+     * Returns: Description, in lower case without a full stop.
+     */
+    static const char *errorDescription(int kind);
+
+    /*
+     * Method: parseNumber
+     * Description: Converts a decimal number in the C locale; surrounding
+     *            : blanks are ignored.
+     * Parameters: begin, end: Text to convert.
+     *           : value: Receives converted value.
+     * Returns: True if the whole text was a number; false otherwise.
+     */
+    static bool parseNumber(const char *begin, const char *end, double *value);
+
+  /* Private members. */
+  private:
+    /*
+     * Method: parseLine
+     * Description: Parses one line, excluding its terminator.
+     * Parameters: begin, end: Line text.
+     * Returns: none.
+     */
+    void parseLine(const char *begin, const char *end) throw(CSVFileException);
+
+    /*
+     * Method: reportError
+     * Description: Fails in strict mode; otherwise logs a problem with the
+     *            : line being parsed.  Warnings are logged in every mode.
+     * Parameters: kind: CSVParseError::Kind.
+     * Returns: none.
+     */
+    void reportError(int kind) throw(CSVFileException);
+
+    QString fileName;
+    CSVDataSet data;
+    ErrorMode errorMode;
+
+    // Bytes fed so far; line number and offset of the line being parsed;
+    // offset of the partial line.
+    qint64 bytesFed;
+    qint64 lineNumber, lineOffset;
+    qint64 partialOffset;
+
+    // Whether the header and the X format have been determined; partial
+    // line carried between chunks.
+    bool headerRead;
+    bool formatDetected;
+    QByteArray partialLine;
+};
+
+#endif // CSVPARSER_H
@@ -0,0 +1,179 @@
+/*
+ * CompressedFileWriter.cpp: See "CompressedFileWriter.h" for documentation.
+ */
+
+#include "CompressedFileWriter.h"
+
+/* C includes. */
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+// Compression level of zstd output; zstd's own default.
+static const int ZstdLevel = 3;
+
+/*
+ * Constructor: CompressedFileWriter
+ */
+CompressedFileWriter::CompressedFileWriter() :
+  fileFormat(Plain),
+  stream(0)
+{
+}
+
+/*
+ * Destructor: ~CompressedFileWriter
+ */
+CompressedFileWriter::~CompressedFileWriter()
+{
+  if (stream && (fileFormat == Gzip))
+    gzclose(gzFile(stream));
+#ifdef HAVE_ZSTD
+  if (stream && (fileFormat == Zstd))
+    ZSTD_freeCStream(static_cast<ZSTD_CStream*>(stream));
+#endif
+}
+
+/*
+ * Method: format
+ */
+CompressedFileWriter::Format CompressedFileWriter::format(const QString &fName)
+{
+  if (fName.endsWith(".gz", Qt::CaseInsensitive))
+    return Gzip;
+  if (fName.endsWith(".zst", Qt::CaseInsensitive))
+    return Zstd;
+  return Plain;
+}
+
+/*
+ * Method: open
+ */
+void CompressedFileWriter::open(const QString &fName) throw(CSVFileException)
+{
+  fileName = fName;
+  fileFormat = format(fName);
+  std::string msg = "Cannot open file \"" + fName.toStdString() +
+      "\" for writing.";
+
+  if (fileFormat == Gzip)
+  {
+    stream = gzopen(QFile::encodeName(fName).constData(), "wb");
+    if (!stream)
+      throw CSVFileException(msg);
+    return;
+  }
+
+#ifdef HAVE_ZSTD
+  if (fileFormat == Zstd)
+  {
+    ZSTD_CStream *zstd = ZSTD_createCStream();
+    if (!zstd || ZSTD_isError(ZSTD_initCStream(zstd, ZstdLevel)))
+    {
+      ZSTD_freeCStream(zstd);
+      throw CSVFileException("Cannot initialize zstd compression.");
+    }
+    stream = zstd;
+    output.resize(int(ZSTD_CStreamOutSize()));
+  }
+#else
+  if (fileFormat == Zstd)
+    throw CSVFileException("Cannot write file \"" + fName.toStdString() +
+                           "\": zstd support was not built in.");
+#endif
+
+  // Line endings are translated only in plain text.
+  outFile.setFileName(fName);
+  QIODevice::OpenMode mode = QFile::WriteOnly | QFile::Truncate;
+  if (fileFormat == Plain)
+    mode |= QFile::Text;
+  if (!outFile.open(mode))
+    throw CSVFileException(msg);
+}
+
+/*
+ * Method: write
+ */
+void CompressedFileWriter::write(const QByteArray &data)
+    throw(CSVFileException)
+{
+  std::string msg = "Error writing file \"" + fileName.toStdString() + "\".";
+  if (data.isEmpty())
+    return;
+
+  if (fileFormat == Gzip)
+  {
+    if (!stream ||
+        (gzwrite(gzFile(stream), data.constData(), unsigned(data.size())) !=
+         data.size()))
+      throw CSVFileException(msg);
+  }
+  else if (fileFormat == Zstd)
+  {
+    writeZstd(data, false);
+  }
+  else if (outFile.write(data) != data.size())
+  {
+    throw CSVFileException(msg);
+  }
+}
+
+/*
+ * Method: close
+ */
+void CompressedFileWriter::close() throw(CSVFileException)
+{
+  std::string msg = "Error writing file \"" + fileName.toStdString() + "\".";
+  if (fileFormat == Gzip)
+  {
+    int status = stream ? gzclose(gzFile(stream)) : Z_OK;
+    stream = 0;
+    if (status != Z_OK)
+      throw CSVFileException(msg);
+    return;
+  }
+
+  if ((fileFormat == Zstd) && stream)
+    writeZstd(QByteArray(), true);
+  if (!outFile.flush())
+    throw CSVFileException(msg);
+  outFile.close();
+}
+
+/*
+ * Method: writeZstd
+ */
+void CompressedFileWriter::writeZstd(const QByteArray &data, bool end)
+    throw(CSVFileException)
+{
+#ifdef HAVE_ZSTD
+  std::string msg = "Error writing file \"" + fileName.toStdString() + "\".";
+  ZSTD_CStream *zstd = static_cast<ZSTD_CStream*>(stream);
+  ZSTD_inBuffer in = { data.constData(), size_t(data.size()), 0 };
+
+  // Drain the output buffer until the input, or the frame, is done.
+  size_t status = 1;
+  while (end ? (status != 0) : (in.pos < in.size))
+  {
+    ZSTD_outBuffer out = { output.data(), size_t(output.size()), 0 };
+    if (end)
+      status = ZSTD_endStream(zstd, &out);
+    else
+      status = ZSTD_compressStream(zstd, &out, &in);
+    if (ZSTD_isError(status) ||
+        (outFile.write(output.constData(), qint64(out.pos)) !=
+         qint64(out.pos)))
+      throw CSVFileException(msg);
+  }
+
+  if (end)
+  {
+    ZSTD_freeCStream(zstd);
+    stream = 0;
+  }
+#else
+  Q_UNUSED(data);
+  Q_UNUSED(end);
+#endif
+}
@@ -0,0 +1,100 @@
+/*
+ * CompressedFileWriter.h: Writes a file plain, or gzip or zstd compressed to
+ *                       : match its name.
+ * Author: B. D. Knopp: bdknopp@users.noreply.github.com
+ * Version: 1.00: Initial implementation; plain, gzip and zstd output.
+ * Date: 19 October 2026
+ */
+
+#ifndef COMPRESSEDFILEWRITER_H
+#define COMPRESSEDFILEWRITER_H
+
+/* Qt includes. */
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+/* Project includes. */
+#include "CSVFileException.h"
+
+/*
+ * Class: CompressedFileWriter
+ * Description: Writes a file in pieces, compressing them on the way when the
+ *            : name ends in ".gz" or ".zst", so that a file saved under the
+ *            : name it was opened from can be opened again.
+ */
+class CompressedFileWriter
+{
+  /* Public types. */
+  public:
+    enum Format { Plain, Gzip, Zstd };
+
+  /* Public methods. */
+  public:
+    /*
+     * Constructor: CompressedFileWriter
+     * Description: Constructs a writer with no file open.
+     * Parameters: none.
+     */
+    CompressedFileWriter();
+
+    /*
+     * Destructor: ~CompressedFileWriter
+     * Description: Closes the file, if still open, without reporting errors.
+     */
+    ~CompressedFileWriter();
+
+    /*
+     * Method: format
+     * Description: Determines the format a file is written in from its name.
+     * Parameters: fName: Name of file.
+     * Returns: Gzip for ".gz", Zstd for ".zst"; Plain otherwise.
+     */
+    static Format format(const QString &fName);
+
+    /*
+     * Method: open
+     * Description: Creates or truncates the named file for writing.
+     * Parameters: fName: Name of file to write.
+     * Returns: none.
+     */
+    void open(const QString &fName) throw(CSVFileException);
+
+    /*
+     * Method: write
+     * Description: Writes the next piece of the file's contents.
+     * Parameters: data: Uncompressed contents.
+     * Returns: none.
+     */
+    void write(const QByteArray &data) throw(CSVFileException);
+
+    /*
+     * Method: close
+     * Description: Finishes the compressed stream, if any, and closes the
+     *            : file.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void close() throw(CSVFileException);
+
+  /* Private members. */
+  private:
+    /*
+     * Method: writeZstd
+     * Description: Compresses data into the file, or ends the zstd frame.
+     * Parameters: data: Uncompressed contents; ignored when ending.
+     *           : end: True to end the frame.
+     * Returns: none.
+     */
+    void writeZstd(const QByteArray &data, bool end) throw(CSVFileException);
+
+    QString fileName;
+    Format fileFormat;
+    QFile outFile;
+
+    // gzFile or ZSTD_CStream of the open file; 0 when plain or closed.
+    void *stream;
+    QByteArray output;
+};
+
+#endif // COMPRESSEDFILEWRITER_H
@@ -0,0 +1,825 @@
+/*
+ * DataColumn.cpp: See "DataColumn.h" for documentation.
+ */
+
+#include "DataColumn.h"
+
+/* C includes. */
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <limits>
+
+/* C++ includes. */
+#include <algorithm>
+
+const double DataColumn::DefaultTolerance = 1e-6;
+
+// Definitions, for uses binding the block sizes to references.
+const int DataColumn::BlockSize;
+const int DataColumn::MaxBlockSize;
+
+// Largest magnitude for which every integer is an exact double.
+static const double ExactIntegerLimit = 9007199254740992.0;
+
+// Decimal scales tried when encoding a block as integers.
+static const double integerScales[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+};
+
+/*
+ * Procedure: writeVarint
+ * Description: Writes a zig-zag encoded signed integer as a varint.
+ * Parameters: value: Value to write.
+ *           : out: Output position; advanced past the written bytes.
+ * Returns: none.
+ */
+static inline void writeVarint(qint64 value, uchar *&out)
+{
+  quint64 bits = (quint64(value) << 1) ^ quint64(value >> 63);
+  while (bits >= 0x80)
+  {
+    *out++ = uchar(bits | 0x80);
+    bits >>= 7;
+  }
+  *out++ = uchar(bits);
+}
+
+/*
+ * Procedure: readVarint
+ * Description: Reads a varint written by writeVarint.
+ * Parameters: in: Input position; advanced past the read bytes.
+ * Returns: Decoded signed integer.
+ */
+static inline qint64 readVarint(const uchar *&in)
+{
+  quint64 bits = 0;
+  int shift = 0;
+  uchar byte;
+  do
+  {
+    byte = *in++;
+    bits |= quint64(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return qint64(bits >> 1) ^ -qint64(bits & 1);
+}
+
+/*
+ * Procedure: encodeDeltaOfDelta
+ * Description: Encodes values as second differences of scaled integers, if
+ *            : some decimal scale reproduces every value exactly.
+ * Parameters: values, count: Values to encode.
+ *           : packed: Receives encoded bytes.
+ *           : scale: Receives the scale used.
+ * Returns: True if encoded; false if no scale is exact.
+ */
+static bool encodeDeltaOfDelta(const double *values, int count,
+                               QByteArray *packed, double *scale)
+{
+  const int scaleCount = sizeof(integerScales) / sizeof(integerScales[0]);
+  for (int s = 0; s < scaleCount; s++)
+  {
+    double candidate = integerScales[s];
+    bool exact = true;
+    for (int i = 0; (i < count) && exact; i++)
+    {
+      double scaled = values[i] * candidate;
+      exact = (std::fabs(scaled) < ExactIntegerLimit) &&
+          (double(qint64(std::floor(scaled + 0.5))) / candidate == values[i]);
+    }
+    if (!exact)
+      continue;
+
+    // Worst case is ten bytes per value.
+    packed->resize(count * 10);
+    uchar *out = reinterpret_cast<uchar*>(packed->data());
+    qint64 previous = 0, delta = 0;
+    for (int i = 0; i < count; i++)
+    {
+      qint64 current = qint64(std::floor(values[i] * candidate + 0.5));
+      if (i == 0)
+        writeVarint(current, out);
+      else if (i == 1)
+        writeVarint(current - previous, out);
+      else
+        writeVarint((current - previous) - delta, out);
+      if (i > 0)
+        delta = current - previous;
+      previous = current;
+    }
+    packed->resize(int(out - reinterpret_cast<uchar*>(packed->data())));
+    packed->squeeze();
+    *scale = candidate;
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Procedure: fitsFloat32
+ * Description: Determines if values survive conversion to float within
+ *            : tolerance relative to their finite span.
+ * Parameters: values, count: Values to test.
+ *           : stats: Statistics of the values.
+ *           : tolerance: Allowed error relative to span.
+ * Returns: True if acceptable; false otherwise.
+ */
+static bool fitsFloat32(const double *values, int count,
+                        const DataColumn::BlockStats &stats, double tolerance)
+{
+  double limit = 0.0;
+  if (stats.minimum == stats.minimum)
+    limit = tolerance * (stats.maximum - stats.minimum);
+
+  for (int i = 0; i < count; i++)
+  {
+    double v = values[i];
+    if (!std::isfinite(v))
+      continue;
+    if (std::fabs(v) > FLT_MAX)
+      return false;
+    if (std::fabs(double(float(v)) - v) > limit)
+      return false;
+  }
+  return true;
+}
+
+/*
+ * Constructor: DataColumn
+ */
+DataColumn::DataColumn() :
+  compaction(false),
+  tolerance(0.0),
+  cachedBlock(-1)
+{
+  starts.append(0);
+}
+
+/*
+ * Method: setCompaction
+ */
+void DataColumn::setCompaction(bool enabled, double tolerance)
+{
+  // Blocks encoded under the same settings are left as they are.
+  bool reencode = !enabled || (tolerance != this->tolerance);
+  compaction = enabled;
+  this->tolerance = tolerance;
+  for (int i = 0; i < blocks.size(); i++)
+  {
+    if (reencode)
+      thaw(i);
+    seal(i);
+  }
+}
+
+/*
+ * Method: clear
+ */
+void DataColumn::clear()
+{
+  blocks.clear();
+  starts.clear();
+  starts.append(0);
+  cachedBlock = -1;
+}
+
+/*
+ * Method: append
+ */
+void DataColumn::append(double value)
+{
+  if (!blocks.isEmpty() && (blocks.last().length < BlockSize))
+    thaw(blocks.size() - 1);
+  else
+  {
+    if (!blocks.isEmpty())
+      seal(blocks.size() - 1);
+
+    Block block;
+    block.encoding = Raw;
+    block.length = 0;
+    block.scale = 1.0;
+    block.raw.reserve(BlockSize);
+    blocks.append(block);
+    starts.append(starts.last());
+  }
+
+  Block &block = blocks.last();
+  BlockStats &stats = block.stats;
+  bool finite = std::isfinite(value);
+  if (block.length == 0)
+  {
+    stats.first = value;
+    stats.minimum = stats.maximum = finite ? value : NAN;
+    stats.finite = finite;
+    stats.ascending = (value == value);
+  }
+  else
+  {
+    stats.ascending = stats.ascending && (value >= stats.last);
+    stats.finite = stats.finite && finite;
+    if (finite)
+    {
+      if (!(value >= stats.minimum))
+        stats.minimum = value;
+      if (!(value <= stats.maximum))
+        stats.maximum = value;
+    }
+  }
+  stats.last = value;
+
+  block.raw.append(value);
+  block.length++;
+  starts.last()++;
+}
+
+/*
+ * Method: value
+ */
+double DataColumn::value(int row) const
+{
+  int index = findBlock(row);
+  const Block &block = blocks.at(index);
+  int offset = row - starts.at(index);
+
+  switch (block.encoding)
+  {
+    case Raw:
+      return block.raw.at(offset);
+    case Float32:
+      return block.narrow.at(offset);
+    default:
+      if (cachedBlock != index)
+      {
+        cache.resize(block.length);
+        decode(block, cache.data());
+        cachedBlock = index;
+      }
+      return cache.at(offset);
+  }
+}
+
+/*
+ * Method: setValue
+ */
+void DataColumn::setValue(int row, double value)
+{
+  int index = findBlock(row);
+  thaw(index);
+  Block &block = blocks[index];
+  block.raw[row - starts.at(index)] = value;
+  computeStats(block);
+}
+
+/*
+ * Method: insert
+ */
+void DataColumn::insert(int row, int count, double value)
+{
+  if (count <= 0)
+    return;
+
+  if (row >= size())
+  {
+    for (int i = 0; i < count; i++)
+      append(value);
+    return;
+  }
+
+  int index = findBlock(row);
+  thaw(index);
+  Block &block = blocks[index];
+  block.raw.insert(row - starts.at(index), count, value);
+  block.length += count;
+
+  if (block.length <= MaxBlockSize)
+  {
+    computeStats(block);
+  }
+  else
+  {
+    // Split an oversized block into nominal-sized pieces.
+    QVector<double> values = block.raw;
+    QVector<Block> pieces;
+    for (int offset = 0; offset < values.size(); offset += BlockSize)
+    {
+      Block piece;
+      piece.encoding = Raw;
+      piece.scale = 1.0;
+      piece.length = qMin(int(BlockSize), values.size() - offset);
+      piece.raw = values.mid(offset, piece.length);
+      computeStats(piece);
+      pieces.append(piece);
+    }
+
+    blocks.remove(index);
+    for (int i = 0; i < pieces.size(); i++)
+      blocks.insert(index + i, pieces.at(i));
+  }
+
+  cachedBlock = -1;
+  rebuildStarts();
+}
+
+/*
+ * Method: remove
+ */
+void DataColumn::remove(int row, int count)
+{
+  if (count <= 0)
+    return;
+
+  // Work backwards so block starts below the current block stay valid.
+  int firstIndex = findBlock(row);
+  int lastIndex = findBlock(row + count - 1);
+  for (int index = lastIndex; index >= firstIndex; index--)
+  {
+    int blockBegin = starts.at(index);
+    int begin = qMax(row, blockBegin) - blockBegin;
+    int end = qMin(row + count, starts.at(index + 1)) - blockBegin;
+
+    if ((begin == 0) && (end == blocks.at(index).length))
+    {
+      blocks.remove(index);
+    }
+    else
+    {
+      thaw(index);
+      Block &block = blocks[index];
+      block.raw.remove(begin, end - begin);
+      block.length -= (end - begin);
+      computeStats(block);
+    }
+  }
+
+  cachedBlock = -1;
+  rebuildStarts();
+}
+
+/*
+ * Procedure: fillRun
+ * Description: Writes the values of an inserted run.
+ * Parameters: out: Destination.
+ *           : values: Values of the run; 0 for empty (NaN) cells.
+ *           : count: Number of values.
+ * Returns: Position after the run.
+ */
+static inline double *fillRun(double *out, const double *values, int count)
+{
+  if (values)
+    memcpy(out, values, count * sizeof(double));
+  else
+    std::fill(out, out + count, double(NAN));
+  return out + count;
+}
+
+/*
+ * Method: insertRanges
+ */
+void DataColumn::insertRanges(const QVector<RowRange> &ranges,
+                              const double *values)
+{
+  if (ranges.isEmpty())
+    return;
+
+  QVector<Block> result;
+  result.reserve(blocks.size() + 1);
+  QVector<double> scratch(MaxBlockSize);
+  QVector<double> merged;
+
+  // A run goes before the existing row at its position less the rows
+  // inserted ahead of it.
+  int r = 0, inserted = 0;
+  for (int b = 0; b < blocks.size(); b++)
+  {
+    int begin = starts.at(b);
+    int end = starts.at(b + 1);
+    if ((r == ranges.size()) || (ranges.at(r).row - inserted >= end))
+    {
+      result.append(blocks.at(b));
+      continue;
+    }
+
+    const double *source = blockData(b, scratch.data());
+    int length = 0;
+    for (int q = r; (q < ranges.size()) && (ranges.at(q).row - inserted -
+                                            length < end); q++)
+      length += ranges.at(q).count;
+    merged.resize(end - begin + length);
+
+    // Copy existing rows and inserted runs alternately.
+    double *out = merged.data();
+    int row = begin;
+    while ((r < ranges.size()) && (ranges.at(r).row - inserted < end))
+    {
+      int at = ranges.at(r).row - inserted;
+      memcpy(out, source + (row - begin), (at - row) * sizeof(double));
+      out += at - row;
+      row = at;
+      out = fillRun(out, values ? values + inserted : 0, ranges.at(r).count);
+      inserted += ranges.at(r).count;
+      r++;
+    }
+    memcpy(out, source + (row - begin), (end - row) * sizeof(double));
+    appendRaw(result, merged.constData(), merged.size());
+  }
+
+  // Runs after the last existing row.
+  int length = 0;
+  for (int q = r; q < ranges.size(); q++)
+    length += ranges.at(q).count;
+  merged.resize(length);
+  double *out = merged.data();
+  for (; r < ranges.size(); r++)
+  {
+    out = fillRun(out, values ? values + inserted : 0, ranges.at(r).count);
+    inserted += ranges.at(r).count;
+  }
+  appendRaw(result, merged.constData(), merged.size());
+
+  blocks = result;
+  cachedBlock = -1;
+  rebuildStarts();
+}
+
+/*
+ * Method: removeRanges
+ */
+void DataColumn::removeRanges(const QVector<RowRange> &ranges,
+                              double *removed)
+{
+  if (ranges.isEmpty())
+    return;
+
+  QVector<Block> result;
+  result.reserve(blocks.size());
+  QVector<double> scratch(MaxBlockSize);
+  QVector<double> kept;
+
+  int r = 0;
+  for (int b = 0; b < blocks.size(); b++)
+  {
+    int begin = starts.at(b);
+    int end = starts.at(b + 1);
+    while ((r < ranges.size()) &&
+           (ranges.at(r).row + ranges.at(r).count <= begin))
+      r++;
+    if ((r == ranges.size()) || (ranges.at(r).row >= end))
+    {
+      result.append(blocks.at(b));
+      continue;
+    }
+
+    const double *source = blockData(b, scratch.data());
+    kept.resize(end - begin);
+    double *out = kept.data();
+    int row = begin;
+    while (row < end)
+    {
+      while ((r < ranges.size()) &&
+             (ranges.at(r).row + ranges.at(r).count <= row))
+        r++;
+
+      // Keep rows up to the next run, then skip the run's rows here.
+      int runBegin = (r < ranges.size()) ? qMax(ranges.at(r).row, row) : end;
+      int keepEnd = qMin(runBegin, end);
+      memcpy(out, source + (row - begin), (keepEnd - row) * sizeof(double));
+      out += keepEnd - row;
+      row = keepEnd;
+      if (row < end)
+      {
+        int runEnd = qMin(ranges.at(r).row + ranges.at(r).count, end);
+        if (removed)
+        {
+          memcpy(removed, source + (row - begin),
+                 (runEnd - row) * sizeof(double));
+          removed += runEnd - row;
+        }
+        row = runEnd;
+      }
+    }
+    appendRaw(result, kept.constData(), int(out - kept.constData()));
+  }
+
+  blocks = result;
+  cachedBlock = -1;
+  rebuildStarts();
+}
+
+/*
+ * Method: read
+ */
+void DataColumn::read(int row, int count, double *out) const
+{
+  if (count <= 0)
+    return;
+
+  QVector<double> scratch;
+  int index = findBlock(row);
+  while (count > 0)
+  {
+    const Block &block = blocks.at(index);
+    int offset = row - starts.at(index);
+    int n = qMin(count, block.length - offset);
+
+    if (block.encoding == Raw)
+    {
+      memcpy(out, block.raw.constData() + offset, n * sizeof(double));
+    }
+    else if (block.encoding == Float32)
+    {
+      const float *narrow = block.narrow.constData() + offset;
+      for (int i = 0; i < n; i++)
+        out[i] = narrow[i];
+    }
+    else
+    {
+      scratch.resize(block.length);
+      decode(block, scratch.data());
+      memcpy(out, scratch.constData() + offset, n * sizeof(double));
+    }
+
+    out += n;
+    row += n;
+    count -= n;
+    index++;
+  }
+}
+
+/*
+ * Method: compact
+ */
+void DataColumn::compact()
+{
+  for (int i = 0; i < blocks.size(); i++)
+    seal(i);
+}
+
+/*
+ * Method: memoryUsage
+ */
+qint64 DataColumn::memoryUsage() const
+{
+  qint64 total = qint64(starts.capacity()) * sizeof(int) +
+      qint64(blocks.capacity()) * sizeof(Block);
+  for (int i = 0; i < blocks.size(); i++)
+  {
+    const Block &block = blocks.at(i);
+    total += qint64(block.raw.capacity()) * sizeof(double);
+    total += qint64(block.narrow.capacity()) * sizeof(float);
+    total += block.packed.capacity();
+  }
+  return total;
+}
+
+/*
+ * Method: isAscending
+ */
+bool DataColumn::isAscending() const
+{
+  for (int i = 0; i < blocks.size(); i++)
+  {
+    const BlockStats &stats = blocks.at(i).stats;
+    if (!stats.ascending)
+      return false;
+    if ((i > 0) && !(blocks.at(i - 1).stats.last <= stats.first))
+      return false;
+  }
+  return true;
+}
+
+/*
+ * Method: minimum
+ */
+double DataColumn::minimum() const
+{
+  double result = NAN;
+  for (int i = 0; i < blocks.size(); i++)
+  {
+    double candidate = blocks.at(i).stats.minimum;
+    if (!(candidate >= result))
+      result = (candidate == candidate) ? candidate : result;
+  }
+  return result;
+}
+
+/*
+ * Method: maximum
+ */
+double DataColumn::maximum() const
+{
+  double result = NAN;
+  for (int i = 0; i < blocks.size(); i++)
+  {
+    double candidate = blocks.at(i).stats.maximum;
+    if (!(candidate <= result))
+      result = (candidate == candidate) ? candidate : result;
+  }
+  return result;
+}
+
+/*
+ * Method: findBlock
+ */
+int DataColumn::findBlock(int row) const
+{
+  // starts[i] <= row < starts[i + 1]
+  const int *begin = starts.constData();
+  const int *end = begin + starts.size() - 1;
+  int index = int(std::upper_bound(begin, end, row) - begin) - 1;
+  return qBound(0, index, blocks.size() - 1);
+}
+
+/*
+ * Method: blockData
+ */
+const double *DataColumn::blockData(int block, double *scratch) const
+{
+  const Block &b = blocks.at(block);
+  if (b.encoding == Raw)
+    return b.raw.constData();
+
+  decode(b, scratch);
+  return scratch;
+}
+
+/*
+ * Method: decode
+ */
+void DataColumn::decode(const Block &block, double *out)
+{
+  if (block.encoding == Raw)
+  {
+    memcpy(out, block.raw.constData(), block.length * sizeof(double));
+  }
+  else if (block.encoding == Float32)
+  {
+    const float *narrow = block.narrow.constData();
+    for (int i = 0; i < block.length; i++)
+      out[i] = narrow[i];
+  }
+  else
+  {
+    const uchar *in = reinterpret_cast<const uchar*>(block.packed.constData());
+    qint64 current = 0, delta = 0;
+    for (int i = 0; i < block.length; i++)
+    {
+      qint64 step = readVarint(in);
+      if (i == 0)
+        current = step;
+      else
+      {
+        delta = (i == 1) ? step : delta + step;
+        current += delta;
+      }
+      out[i] = double(current) / block.scale;
+    }
+  }
+}
+
+/*
+ * Method: summarize
+ */
+DataColumn::BlockStats DataColumn::summarize(const double *values, int count)
+{
+  BlockStats stats;
+  stats.minimum = stats.maximum = NAN;
+  stats.finite = true;
+  stats.ascending = true;
+  stats.first = (count > 0) ? values[0] : NAN;
+  stats.last = (count > 0) ? values[count - 1] : NAN;
+
+  for (int i = 0; i < count; i++)
+  {
+    double v = values[i];
+    if (std::isfinite(v))
+    {
+      if (!(v >= stats.minimum))
+        stats.minimum = v;
+      if (!(v <= stats.maximum))
+        stats.maximum = v;
+    }
+    else
+    {
+      stats.finite = false;
+    }
+
+    if (!((i == 0) ? (v == v) : (v >= values[i - 1])))
+      stats.ascending = false;
+  }
+  return stats;
+}
+
+/*
+ * Method: computeStats
+ */
+void DataColumn::computeStats(Block &block)
+{
+  block.stats = summarize(block.raw.constData(), block.length);
+}
+
+/*
+ * Method: appendRaw
+ */
+void DataColumn::appendRaw(QVector<Block> &out, const double *values,
+                           int count)
+{
+  int pieceSize = (count > MaxBlockSize) ? int(BlockSize) : count;
+  for (int offset = 0; offset < count; offset += pieceSize)
+  {
+    Block piece;
+    piece.encoding = Raw;
+    piece.scale = 1.0;
+    piece.length = qMin(pieceSize, count - offset);
+    piece.raw.resize(piece.length);
+    memcpy(piece.raw.data(), values + offset,
+           piece.length * sizeof(double));
+    computeStats(piece);
+    out.append(piece);
+  }
+}
+
+/*
+ * Method: thaw
+ */
+void DataColumn::thaw(int index)
+{
+  Block &block = blocks[index];
+  if (block.encoding == Raw)
+    return;
+
+  block.raw.resize(block.length);
+  decode(block, block.raw.data());
+  block.encoding = Raw;
+  block.narrow = QVector<float>();
+  block.packed = QByteArray();
+  if (cachedBlock == index)
+    cachedBlock = -1;
+}
+
+/*
+ * Method: seal
+ */
+void DataColumn::seal(int index)
+{
+  Block &block = blocks[index];
+  if (!compaction || (block.encoding != Raw) || (block.length == 0))
+    return;
+
+  const double *values = block.raw.constData();
+  QByteArray packed;
+  double scale = 1.0;
+  bool integral = encodeDeltaOfDelta(values, block.length, &packed, &scale);
+  int narrowSize = block.length * int(sizeof(float));
+
+  if (integral && (packed.size() <= narrowSize))
+  {
+    block.encoding = DeltaOfDelta;
+    block.packed = packed;
+    block.scale = scale;
+  }
+  else if (fitsFloat32(values, block.length, block.stats, tolerance))
+  {
+    block.encoding = Float32;
+    block.narrow.resize(block.length);
+    for (int i = 0; i < block.length; i++)
+      block.narrow[i] = float(values[i]);
+
+    // Statistics describe the stored values.
+    block.raw = QVector<double>();
+    block.raw.resize(block.length);
+    decode(block, block.raw.data());
+    computeStats(block);
+  }
+  else if (integral &&
+           (packed.size() < block.length * int(sizeof(double))))
+  {
+    block.encoding = DeltaOfDelta;
+    block.packed = packed;
+    block.scale = scale;
+  }
+  else
+  {
+    return;
+  }
+
+  block.raw = QVector<double>();
+  if (cachedBlock == index)
+    cachedBlock = -1;
+}
+
+/*
+ * Method: rebuildStarts
+ */
+void DataColumn::rebuildStarts()
+{
+  starts.resize(blocks.size() + 1);
+  int row = 0;
+  for (int i = 0; i < blocks.size(); i++)
+  {
+    starts[i] = row;
+    row += blocks.at(i).length;
+  }
+  starts[blocks.size()] = row;
+}
@@ -0,0 +1,346 @@
+/*
+ * DataColumn.h: Block-structured storage for one column of the data model,
+ *             : with optional compact per-block encodings.
+ * Author: B. D. Knopp: bdknopp@users.noreply.github.com
+ * Version: 1.00: Initial implementation; raw, float32 and delta-of-delta
+ *        :     : blocks.
+ * Date: 19 October 2026
+ */
+
+#ifndef DATACOLUMN_H
+#define DATACOLUMN_H
+
+/* Qt includes. */
+#include <QVector>
+#include <QByteArray>
+
+/*
+ * Class: DataColumn
+ * Description: Stores a column of doubles as a sequence of blocks of about
+ *            : BlockSize rows.  When compaction is enabled, each block is
+ *            : encoded as it fills: regularly spaced values (timestamps) as
+ *            : scaled-integer delta-of-delta varints, and values whose span
+ *            : tolerates it as float32.  Both encodings are checked per
+ *            : block and a block stays raw if neither is acceptable.  Each
+ *            : block keeps summary statistics so readers can often skip
+ *            : decoding it altogether.
+ *            :
+ *            : Block boundaries depend only on the sequence of structural
+ *            : operations, so two columns edited identically (as the X and
+ *            : Y columns of the model are) always have aligned blocks.
+ */
+class DataColumn
+{
+  /* Public types. */
+  public:
+    /*
+     * Enum: Encoding
+     * Description: Storage format of a single block.
+     */
+    enum Encoding { Raw, Float32, DeltaOfDelta };
+
+    /*
+     * Struct: BlockStats
+     * Description: Summary of the values in one block.  Minimum and maximum
+     *            : cover finite values only; NaN if there are none.
+     */
+    struct BlockStats
+    {
+      double minimum, maximum;
+      double first, last;
+      bool finite;
+      bool ascending;
+    };
+
+    /*
+     * Struct: RowRange
+     * Description: Run of consecutive rows.
+     */
+    struct RowRange
+    {
+      int row;
+      int count;
+    };
+
+    // Nominal rows per block; blocks grown by insertion are split beyond
+    // MaxBlockSize.
+    static const int BlockSize = 4096;
+    static const int MaxBlockSize = 2 * BlockSize;
+
+    // Float32 error allowed for Y data, relative to each block's span.
+    static const double DefaultTolerance;
+
+  /* Public methods. */
+  public:
+    /*
+     * Constructor: DataColumn
+     * Description: Creates an empty column with compaction disabled.
+     */
+    DataColumn();
+
+    /*
+     * Method: setCompaction
+     * Description: Enables or disables compact encoding; encodes or
+     *            : expands existing blocks to match.
+     * Parameters: enabled: Whether to encode full blocks.
+     *           : tolerance: Float32 error allowed relative to block span;
+     *           :          : zero permits only exact conversions.
+     * Returns: none.
+     */
+    void setCompaction(bool enabled, double tolerance = 0.0);
+
+    /*
+     * Methods: isCompacting, compactionTolerance
+     * Description: Retrieve the compaction settings.
+     * Parameters: none.
+     * Returns: Whether full blocks are encoded; float32 error allowed.
+     */
+    bool isCompacting() const { return compaction; }
+    double compactionTolerance() const { return tolerance; }
+
+    /*
+     * Method: size
+     * Description: Retrieves the number of rows in the column.
+     * Parameters: none.
+     * Returns: Row count.
+     */
+    int size() const { return starts.last(); }
+
+    /*
+     * Method: clear
+     * Description: Removes all rows.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void clear();
+
+    /*
+     * Method: append
+     * Description: Appends a value; encodes the previous block once full.
+     * Parameters: value: Value to append.
+     * Returns: none.
+     */
+    void append(double value);
+
+    /*
+     * Method: value
+     * Description: Retrieves a single value.  Decodes through a one-block
+     *            : cache, so is not safe to call from several threads.
+     * Parameters: row: Row of value.
+     * Returns: Value at row.
+     */
+    double value(int row) const;
+
+    /*
+     * Method: setValue
+     * Description: Replaces a single value; the block is stored raw
+     *            : until the column is next compacted.
+     * Parameters: row: Row of value.
+     *           : value: New value.
+     * Returns: none.
+     */
+    void setValue(int row, double value);
+
+    /*
+     * Method: insert
+     * Description: Inserts rows, all holding the same value.
+     * Parameters: row: Row to insert before; size() to append.
+     *           : count: Number of rows to insert.
+     *           : value: Value of inserted rows.
+     * Returns: none.
+     */
+    void insert(int row, int count, double value);
+
+    /*
+     * Method: remove
+     * Description: Removes a contiguous range of rows.
+     * Parameters: row: First row to remove.
+     *           : count: Number of rows to remove.
+     * Returns: none.
+     */
+    void remove(int row, int count);
+
+    /*
+     * Method: insertRanges
+     * Description: Inserts several runs of rows in one pass over the
+     *            : blocks.  Blocks receiving no rows are kept as they are;
+     *            : the others are rebuilt raw, as by insert().
+     * Parameters: ranges: Disjoint runs in ascending order, giving the rows
+     *           :       : they occupy once inserted.
+     *           : values: Values of the inserted rows in row order; 0 to
+     *           :       : insert empty (NaN) cells.
+     * Returns: none.
+     */
+    void insertRanges(const QVector<RowRange> &ranges, const double *values);
+
+    /*
+     * Method: removeRanges
+     * Description: Removes several runs of rows in one pass over the
+     *            : blocks.  Blocks losing no rows are kept as they are; the
+     *            : others are rebuilt raw, as by remove().
+     * Parameters: ranges: Disjoint runs in ascending order.
+     *           : removed: Receives the values removed in row order; may be
+     *           :        : 0.
+     * Returns: none.
+     */
+    void removeRanges(const QVector<RowRange> &ranges, double *removed);
+
+    /*
+     * Method: read
+     * Description: Copies a range of values out; safe for concurrent use.
+     * Parameters: row: First row to read.
+     *           : count: Number of rows to read.
+     *           : out: Receives count values.
+     * Returns: none.
+     */
+    void read(int row, int count, double *out) const;
+
+    /*
+     * Method: compact
+     * Description: Encodes every raw block, if compaction is enabled.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void compact();
+
+    /*
+     * Method: memoryUsage
+     * Description: Estimates the heap memory held by the column.
+     * Parameters: none.
+     * Returns: Size in bytes.
+     */
+    qint64 memoryUsage() const;
+
+    /*
+     * Method: isAscending
+     * Description: Determines if values are non-decreasing and free of NaN.
+     * Parameters: none.
+     * Returns: True if ascending; false otherwise.
+     */
+    bool isAscending() const;
+
+    /*
+     * Methods: minimum, maximum
+     * Description: Retrieves the extremes of the finite values.
+     * Parameters: none.
+     * Returns: Minimum or maximum; NaN if there are no finite values.
+     */
+    double minimum() const;
+    double maximum() const;
+
+    /*
+     * Methods: blockCount, blockStart, blockLength, findBlock, blockStats
+     * Description: Block structure accessors for bulk readers.
+     * Parameters: block: Index of block.
+     *           : row: Row to locate.
+     * Returns: Count, first row, length, containing block, or statistics.
+     */
+    int blockCount() const { return blocks.size(); }
+    int blockStart(int block) const { return starts.at(block); }
+    int blockLength(int block) const { return blocks.at(block).length; }
+    int findBlock(int row) const;
+    const BlockStats &blockStats(int block) const
+    {
+      return blocks.at(block).stats;
+    }
+
+    /*
+     * Method: blockData
+     * Description: Retrieves the values of a block, decoding into scratch
+     *            : if it is encoded.  Safe for concurrent use.
+     * Parameters: block: Index of block.
+     *           : scratch: Buffer of at least MaxBlockSize values.
+     * Returns: Pointer to blockLength(block) values.
+     */
+    const double *blockData(int block, double *scratch) const;
+
+    /*
+     * Method: summarize
+     * Description: Computes block statistics for a run of values.
+     * Parameters: values, count: Values to summarize.
+     * Returns: Statistics of the values.
+     */
+    static BlockStats summarize(const double *values, int count);
+
+  /* Private types. */
+  private:
+    struct Block
+    {
+      Encoding encoding;
+      int length;
+      BlockStats stats;
+      double scale;
+      QVector<double> raw;
+      QVector<float> narrow;
+      QByteArray packed;
+    };
+
+  /* Private members. */
+  private:
+    /*
+     * Method: decode
+     * Description: Decodes a block into out.
+     * Parameters: block: Block to decode.
+     *           : out: Receives block.length values.
+     * Returns: none.
+     */
+    static void decode(const Block &block, double *out);
+
+    /*
+     * Method: computeStats
+     * Description: Recomputes summary statistics of a raw block.
+     * Parameters: block: Block to update.
+     * Returns: none.
+     */
+    static void computeStats(Block &block);
+
+    /*
+     * Method: appendRaw
+     * Description: Appends values as raw blocks, split into nominal-sized
+     *            : pieces if they exceed MaxBlockSize.
+     * Parameters: out: Blocks to append to.
+     *           : values, count: Values to append; none if count is 0.
+     * Returns: none.
+     */
+    static void appendRaw(QVector<Block> &out, const double *values,
+                          int count);
+
+    /*
+     * Method: thaw
+     * Description: Converts a block back to raw storage for editing.
+     * Parameters: index: Index of block.
+     * Returns: none.
+     */
+    void thaw(int index);
+
+    /*
+     * Method: seal
+     * Description: Encodes a raw block, if compaction is enabled and an
+     *            : encoding is acceptable and smaller.
+     * Parameters: index: Index of block.
+     * Returns: none.
+     */
+    void seal(int index);
+
+    /*
+     * Method: rebuildStarts
+     * Description: Recomputes the first row of each block.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void rebuildStarts();
+
+    QVector<Block> blocks;
+
+    // First row of each block, plus the total row count.
+    QVector<int> starts;
+
+    bool compaction;
+    double tolerance;
+
+    // Last block decoded by value().
+    mutable int cachedBlock;
+    mutable QVector<double> cache;
+};
+
+#endif // DATACOLUMN_H
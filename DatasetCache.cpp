@@ -0,0 +1,458 @@
+/*
+ * DatasetCache.cpp: See "DatasetCache.h" for documentation.
+ */
+
+#include "DatasetCache.h"
+
+/* Qt includes. */
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QVector>
+
+// Identifies spill files, and their layout.
+static const quint32 SpillMagic = 0x43535644;
+static const quint32 SpillVersion = 2;
+
+/*
+ * Procedure: writeColumn
+ * Description: Writes a column's compaction settings and values.
+ * Parameters: out: Stream to write to.
+ *           : column: Column to write.
+ * Returns: none.
+ */
+static void writeColumn(QDataStream &out, const DataColumn &column)
+{
+  out << column.isCompacting() << column.compactionTolerance()
+      << qint32(column.size());
+
+  QVector<double> scratch(DataColumn::MaxBlockSize);
+  for (int b = 0; b < column.blockCount(); b++)
+  {
+    const double *values = column.blockData(b, scratch.data());
+    out.writeRawData(reinterpret_cast<const char *>(values),
+                     column.blockLength(b) * int(sizeof(double)));
+  }
+}
+
+/*
+ * Procedure: readColumn
+ * Description: Reads a column written by writeColumn, encoding it as it
+ *            : was encoded when written.
+ * Parameters: in: Stream to read from.
+ *           : column: Receives the column.
+ * Returns: True if read whole; false otherwise.
+ */
+static bool readColumn(QDataStream &in, DataColumn *column)
+{
+  bool compacting;
+  double tolerance;
+  qint32 rows;
+  in >> compacting >> tolerance >> rows;
+  if ((in.status() != QDataStream::Ok) || (rows < 0))
+    return false;
+
+  column->clear();
+  column->setCompaction(compacting, tolerance);
+  QVector<double> buffer(DataColumn::BlockSize);
+  for (int row = 0; row < rows; )
+  {
+    int count = rows - row;
+    if (count > DataColumn::BlockSize)
+      count = DataColumn::BlockSize;
+
+    int bytes = count * int(sizeof(double));
+    if (in.readRawData(reinterpret_cast<char *>(buffer.data()), bytes) !=
+        bytes)
+      return false;
+    for (int i = 0; i < count; i++)
+      column->append(buffer.at(i));
+    row += count;
+  }
+
+  // Encode the final, partially filled block.
+  column->compact();
+  return true;
+}
+
+/*
+ * Procedure: writeLog
+ * Description: Writes a parse log.
+ * Parameters: out: Stream to write to.
+ *           : log: Log to write.
+ * Returns: none.
+ */
+static void writeLog(QDataStream &out, const CSVParseLog &log)
+{
+  out << log.count << qint32(log.errors.size());
+  for (int i = 0; i < log.errors.size(); i++)
+  {
+    const CSVParseError &error = log.errors.at(i);
+    out << error.line << error.offset << qint32(error.row)
+        << qint32(error.kind);
+  }
+}
+
+/*
+ * Procedure: readLog
+ * Description: Reads a parse log written by writeLog.
+ * Parameters: in: Stream to read from.
+ *           : log: Receives the log.
+ * Returns: True if read whole; false otherwise.
+ */
+static bool readLog(QDataStream &in, CSVParseLog *log)
+{
+  qint32 size;
+  in >> log->count >> size;
+  if ((in.status() != QDataStream::Ok) || (size < 0) ||
+      (size > CSVParser::MaxLoggedErrors))
+    return false;
+
+  log->errors.resize(size);
+  for (int i = 0; i < size; i++)
+  {
+    CSVParseError &error = log->errors[i];
+    qint32 row, kind;
+    in >> error.line >> error.offset >> row >> kind;
+    error.row = row;
+    error.kind = kind;
+  }
+  return in.status() == QDataStream::Ok;
+}
+
+/*
+ * Procedure: dataSetBytes
+ * Description: Estimates the memory held by a data set's columns.
+ * Parameters: dataSet: Data set to measure.
+ * Returns: Size in bytes.
+ */
+static qint64 dataSetBytes(const CSVDataSet &dataSet)
+{
+  return dataSet.xData.memoryUsage() + dataSet.yData.memoryUsage() +
+      dataSet.parseLog.errors.size() * qint64(sizeof(CSVParseError));
+}
+
+/*
+ * Constructor: DatasetCache
+ */
+DatasetCache::DatasetCache() :
+  memoryBudget(DefaultBudget),
+  useCount(0)
+{
+}
+
+/*
+ * Method: open
+ */
+int DatasetCache::open(const QString &fName, bool compact,
+                       CSVParser::ErrorMode mode) throw(CSVFileException)
+{
+  QHash<QString, int>::const_iterator found = keys.constFind(fileKey(fName));
+  if ((found != keys.constEnd()) && (entries.at(found.value()).mode == mode))
+  {
+    entries[found.value()].lastUse = ++useCount;
+    return found.value();
+  }
+
+  // A file changed since, or parsed with other handling of malformed
+  //   lines, is parsed again in place of the data held.
+  return add(fName, CSVParser::parseFile(fName, compact, mode), mode);
+}
+
+/*
+ * Method: add
+ */
+int DatasetCache::add(const QString &fName, const CSVDataSet &dataSet,
+                      CSVParser::ErrorMode mode)
+{
+  QString key = fileKey(fName);
+  QHash<QString, int>::const_iterator found = keys.constFind(key);
+  if ((found != keys.constEnd()) && (entries.at(found.value()).mode == mode))
+    return found.value();
+
+  QString path = filePath(fName);
+  int id = paths.value(path, -1);
+  if (id >= 0)
+  {
+    Entry &entry = entries[id];
+    keys.remove(entry.key);
+    entry.fileName = fName;
+    entry.key = key;
+    entry.mode = mode;
+    keys.insert(key, id);
+    replace(id, dataSet);
+    return id;
+  }
+
+  Entry entry;
+  entry.fileName = fName;
+  entry.key = key;
+  entry.path = path;
+  entry.data = dataSet;
+  entry.bytes = dataSetBytes(dataSet);
+  entry.lastUse = ++useCount;
+  entry.pins = 0;
+  entry.mode = mode;
+  entry.resident = true;
+  entry.spilled = false;
+  entry.open = true;
+
+  id = entries.size();
+  entries.append(entry);
+  keys.insert(key, id);
+  paths.insert(path, id);
+  trim();
+  return id;
+}
+
+/*
+ * Method: dataSet
+ */
+CSVDataSet DatasetCache::dataSet(int id) throw(CSVFileException)
+{
+  if (!entries.at(id).resident)
+    reload(id);
+
+  entries[id].lastUse = ++useCount;
+  trim();
+  return entries.at(id).data;
+}
+
+/*
+ * Method: store
+ */
+void DatasetCache::store(int id, const CSVDataSet &dataSet)
+{
+  // The file no longer holds these contents.
+  Entry &entry = entries[id];
+  if (!entry.key.isEmpty())
+  {
+    keys.remove(entry.key);
+    paths.remove(entry.path);
+    entry.key.clear();
+    entry.path.clear();
+  }
+  replace(id, dataSet);
+}
+
+/*
+ * Method: close
+ */
+void DatasetCache::close(int id)
+{
+  Entry &entry = entries[id];
+  if (!entry.key.isEmpty())
+  {
+    keys.remove(entry.key);
+    paths.remove(entry.path);
+    entry.key.clear();
+    entry.path.clear();
+  }
+
+  // A spill file may outlive the data it held, once replaced.
+  QFile::remove(spillName(id));
+
+  entry.data = CSVDataSet();
+  entry.bytes = 0;
+  entry.pins = 0;
+  entry.resident = false;
+  entry.spilled = false;
+  entry.open = false;
+}
+
+/*
+ * Method: pin
+ */
+void DatasetCache::pin(int id)
+{
+  entries[id].pins++;
+}
+
+/*
+ * Method: unpin
+ */
+void DatasetCache::unpin(int id)
+{
+  Entry &entry = entries[id];
+  if (entry.pins > 0)
+    entry.pins--;
+  trim();
+}
+
+/*
+ * Method: setBudget
+ */
+void DatasetCache::setBudget(qint64 bytes)
+{
+  memoryBudget = bytes;
+  trim();
+}
+
+/*
+ * Method: memoryUsage
+ */
+qint64 DatasetCache::memoryUsage() const
+{
+  qint64 bytes = 0;
+  for (int i = 0; i < entries.size(); i++)
+  {
+    if (entries.at(i).resident)
+      bytes += entries.at(i).bytes;
+  }
+  return bytes;
+}
+
+/*
+ * Method: openCount
+ */
+int DatasetCache::openCount() const
+{
+  int count = 0;
+  for (int i = 0; i < entries.size(); i++)
+  {
+    if (entries.at(i).open)
+      count++;
+  }
+  return count;
+}
+
+/*
+ * Method: filePath
+ */
+QString DatasetCache::filePath(const QString &fName)
+{
+  QFileInfo info(fName);
+  QString path = info.canonicalFilePath();
+  if (path.isEmpty())
+    path = info.absoluteFilePath();
+  return path;
+}
+
+/*
+ * Method: fileKey
+ */
+QString DatasetCache::fileKey(const QString &fName)
+{
+  QFileInfo info(fName);
+  return filePath(fName) + QString("|%1|%2").arg(info.size())
+      .arg(info.lastModified().toMSecsSinceEpoch());
+}
+
+/*
+ * Method: replace
+ */
+void DatasetCache::replace(int id, const CSVDataSet &dataSet)
+{
+  Entry &entry = entries[id];
+  entry.data = dataSet;
+  entry.bytes = dataSetBytes(dataSet);
+  entry.lastUse = ++useCount;
+  entry.resident = true;
+  entry.spilled = false;
+  trim();
+}
+
+/*
+ * Method: trim
+ */
+void DatasetCache::trim()
+{
+  qint64 used = memoryUsage();
+  while (used > memoryBudget)
+  {
+    // The data set used last is about to be shown; never spill it.
+    int victim = -1;
+    for (int i = 0; i < entries.size(); i++)
+    {
+      const Entry &entry = entries.at(i);
+      if (entry.resident && (entry.pins == 0) &&
+          (entry.lastUse != useCount) &&
+          ((victim < 0) || (entry.lastUse < entries.at(victim).lastUse)))
+        victim = i;
+    }
+
+    qint64 bytes = (victim >= 0) ? entries.at(victim).bytes : 0;
+    if ((victim < 0) || !spill(victim))
+      return;
+    used -= bytes;
+  }
+}
+
+/*
+ * Method: spill
+ */
+bool DatasetCache::spill(int id)
+{
+  Entry &entry = entries[id];
+
+  // Data reloaded and not since replaced is already on disk.
+  if (!entry.spilled)
+  {
+    if (!spillDirectory.isValid())
+      return false;
+
+    QFile file(spillName(id));
+    if (!file.open(QIODevice::WriteOnly))
+      return false;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << SpillMagic << SpillVersion << entry.data.xLabel
+        << entry.data.yLabel << qint32(entry.data.xTimeFormat);
+    writeColumn(out, entry.data.xData);
+    writeColumn(out, entry.data.yData);
+    writeLog(out, entry.data.parseLog);
+    file.close();
+    if ((out.status() != QDataStream::Ok) ||
+        (file.error() != QFileDevice::NoError))
+    {
+      file.remove();
+      return false;
+    }
+    entry.spilled = true;
+  }
+
+  entry.data = CSVDataSet();
+  entry.resident = false;
+  return true;
+}
+
+/*
+ * Method: reload
+ */
+void DatasetCache::reload(int id) throw(CSVFileException)
+{
+  Entry &entry = entries[id];
+  std::string msg = "Unable to reload data of \"" +
+      entry.fileName.toStdString() + "\".";
+
+  QFile file(spillName(id));
+  if (!file.open(QIODevice::ReadOnly))
+    throw CSVFileException(msg);
+
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_5_0);
+  quint32 magic, version;
+  qint32 format;
+  CSVDataSet data;
+  in >> magic >> version >> data.xLabel >> data.yLabel >> format;
+  if ((in.status() != QDataStream::Ok) || (magic != SpillMagic) ||
+      (version != SpillVersion) || !readColumn(in, &data.xData) ||
+      !readColumn(in, &data.yData) || !readLog(in, &data.parseLog) ||
+      (data.xData.size() != data.yData.size()))
+    throw CSVFileException(msg);
+
+  data.xTimeFormat = TimestampParser::Format(format);
+  entry.data = data;
+  entry.bytes = dataSetBytes(data);
+  entry.resident = true;
+}
+
+/*
+ * Method: spillName
+ */
+QString DatasetCache::spillName(int id) const
+{
+  return spillDirectory.path() + QString("/%1.bin").arg(id);
+}
@@ -0,0 +1,229 @@
+/*
+ * DatasetCache.h: Open data sets of a workspace, held in memory up to a
+ *               : budget and spilled to temporary files beyond it.
+ * Author: B. D. Knopp: bdknopp@users.noreply.github.com
+ * Version: 1.00: Initial implementation.
+ * Date: 19 October 2026
+ */
+
+#ifndef DATASETCACHE_H
+#define DATASETCACHE_H
+
+/* Qt includes. */
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QTemporaryDir>
+
+/* Project includes. */
+#include "CSVFileException.h"
+#include "CSVParser.h"
+
+/*
+ * Class: DatasetCache
+ * Description: Holds every data set opened in one process, each once.  Files
+ *            : are identified by canonical path, size and modification
+ *            : time, so opening a file again shares the data already held
+ *            : rather than parsing it anew; a file changed since is parsed
+ *            : again in place.  Edited data sets are working copies, no
+ *            : longer found by opening their file.  Data sets are implicitly
+ *            : shared with the models and views showing them, which pin
+ *            : them in memory.  When the unpinned data sets exceed the
+ *            : budget, the least recently used are written to a temporary
+ *            : file in binary form and reloaded from it when next needed,
+ *            : without re-parsing.
+ */
+class DatasetCache
+{
+  /* Public types. */
+  public:
+    // Memory budget, by default.
+    static const qint64 DefaultBudget = qint64(1) << 30;
+
+  /* Public methods. */
+  public:
+    /*
+     * Constructor: DatasetCache
+     * Description: Creates an empty cache with the default budget.
+     */
+    DatasetCache();
+
+    /*
+     * Method: open
+     * Description: Finds the data set of a file, parsing it if the file
+     *            : has not been opened, has changed since, or was parsed
+     *            : with other handling of malformed lines.
+     * Parameters: fName: Name of CSV file to open.
+     *           : compact: Whether to parse with compact column encodings.
+     *           : mode: Handling of malformed lines.
+     * Returns: Identifier of the data set.
+     */
+    int open(const QString &fName, bool compact, CSVParser::ErrorMode mode)
+        throw(CSVFileException);
+
+    /*
+     * Method: add
+     * Description: Adds a data set parsed elsewhere from a file.
+     * Parameters: fName: Name of the file parsed.
+     *           : dataSet: Parsed contents.
+     *           : mode: Handling of malformed lines used to parse it.
+     * Returns: Identifier of the data set; that of an unedited data set of
+     *        : the same file, if any, whose contents are replaced only if
+     *        : the file has changed or was parsed in another mode.
+     */
+    int add(const QString &fName, const CSVDataSet &dataSet,
+            CSVParser::ErrorMode mode);
+
+    /*
+     * Method: dataSet
+     * Description: Retrieves a data set, reloading it if spilled, and marks
+     *            : it most recently used.
+     * Parameters: id: Identifier of the data set.
+     * Returns: Data set, sharing the cache's column storage.
+     */
+    CSVDataSet dataSet(int id) throw(CSVFileException);
+
+    /*
+     * Method: store
+     * Description: Replaces a data set with edited contents.  The data set
+     *            : becomes a working copy: opening its file again parses
+     *            : the file anew, as another data set.
+     * Parameters: id: Identifier of the data set.
+     *           : dataSet: New contents.
+     * Returns: none.
+     */
+    void store(int id, const CSVDataSet &dataSet);
+
+    /*
+     * Method: close
+     * Description: Releases a data set: its memory, its spill file and its
+     *            : place among the files opened, so opening the file again
+     *            : parses it anew.  Its identifier is not reused.
+     * Parameters: id: Identifier of the data set.
+     * Returns: none.
+     */
+    void close(int id);
+
+    /*
+     * Methods: pin, unpin
+     * Description: Mark a data set as shown, so that it is not spilled, or
+     *            : release such a mark.  Marks are counted.
+     * Parameters: id: Identifier of the data set.
+     * Returns: none.
+     */
+    void pin(int id);
+    void unpin(int id);
+
+    /*
+     * Methods: setBudget, budget
+     * Description: Replace or retrieve the memory budget; lowering it
+     *            : spills data sets at once.
+     * Parameters: bytes: Budget in bytes.
+     * Returns: none; or the budget in bytes.
+     */
+    void setBudget(qint64 bytes);
+    qint64 budget() const { return memoryBudget; }
+
+    /*
+     * Method: memoryUsage
+     * Description: Totals the memory of the data sets held in memory.
+     * Parameters: none.
+     * Returns: Size in bytes.
+     */
+    qint64 memoryUsage() const;
+
+    /*
+     * Methods: count, openCount, fileName, isOpen, isResident
+     * Description: Describe the data sets held.
+     * Parameters: id: Identifier of a data set, from 0 to count() - 1.
+     * Returns: Number of identifiers issued; number of data sets not
+     *        : closed; file name; whether not closed; whether held in
+     *        : memory.
+     */
+    int count() const { return entries.size(); }
+    int openCount() const;
+    QString fileName(int id) const { return entries.at(id).fileName; }
+    bool isOpen(int id) const { return entries.at(id).open; }
+    bool isResident(int id) const { return entries.at(id).resident; }
+
+  /* Private types. */
+  private:
+    /*
+     * Struct: Entry
+     * Description: One data set, and where its contents are held.
+     */
+    struct Entry
+    {
+      // Key and canonical path; both empty once edited.
+      QString fileName, key, path;
+      CSVDataSet data;
+      qint64 bytes;
+      qint64 lastUse;
+      int pins;
+      CSVParser::ErrorMode mode;
+
+      // Whether data is held; whether the spill file matches the data;
+      // whether not yet closed.
+      bool resident, spilled, open;
+    };
+
+  /* Private members. */
+  private:
+    /*
+     * Methods: filePath, fileKey
+     * Description: Build the path and the identity of a file.
+     * Parameters: fName: File name.
+     * Returns: Canonical path; that with size and modification time.
+     */
+    static QString filePath(const QString &fName);
+    static QString fileKey(const QString &fName);
+
+    /*
+     * Method: replace
+     * Description: Replaces the contents of a data set, as held in memory.
+     * Parameters: id: Identifier of the data set.
+     *           : dataSet: New contents.
+     * Returns: none.
+     */
+    void replace(int id, const CSVDataSet &dataSet);
+
+    /*
+     * Method: trim
+     * Description: Spills least recently used, unpinned data sets until
+     *            : the budget is met.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void trim();
+
+    /*
+     * Methods: spill, reload
+     * Description: Write a data set to its spill file and release it, or
+     *            : read it back.
+     * Parameters: id: Identifier of the data set.
+     * Returns: True if spilled; false if it could not be written, in which
+     *        : case it stays in memory.  reload returns nothing.
+     */
+    bool spill(int id);
+    void reload(int id) throw(CSVFileException);
+
+    /*
+     * Method: spillName
+     * Description: Names the spill file of a data set.
+     * Parameters: id: Identifier of the data set.
+     * Returns: File name in the temporary directory.
+     */
+    QString spillName(int id) const;
+
+    // Entries; those not edited, by file key and by canonical path.
+    QList<Entry> entries;
+    QHash<QString, int> keys;
+    QHash<QString, int> paths;
+    qint64 memoryBudget;
+    qint64 useCount;
+
+    // Holds the spill files; removed with the cache.
+    QTemporaryDir spillDirectory;
+};
+
+#endif // DATASETCACHE_H
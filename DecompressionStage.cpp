@@ -0,0 +1,333 @@
+/*
+ * DecompressionStage.cpp: See "DecompressionStage.h" for documentation.
+ */
+
+#include "DecompressionStage.h"
+
+/* C includes. */
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+// Size of the compressed read buffer used by the inflating loops.
+static const int InputSize = 256 * 1024;
+
+/*
+ * Constructor: DecompressionStage
+ */
+DecompressionStage::DecompressionStage(QString fName, QObject *parent) :
+  QThread(parent),
+  fileName(fName),
+  inFile(fName),
+  inputFormat(Plain),
+  finished(false),
+  cancelled(false)
+{
+  for (int i = 0; i < ChunkCount; i++)
+  {
+    chunks[i].buffer.resize(ChunkSize);
+    chunks[i].length = 0;
+    freeChunks.enqueue(&chunks[i]);
+  }
+}
+
+/*
+ * Destructor: ~DecompressionStage
+ */
+DecompressionStage::~DecompressionStage()
+{
+  cancel();
+  wait();
+}
+
+/*
+ * Method: open
+ */
+void DecompressionStage::open() throw(CSVFileException)
+{
+  if (!inFile.open(QIODevice::ReadOnly))
+  {
+    // Couldn't open file; abort with exception.
+    std::string msg = "Cannot open file \"" + fileName.toStdString() +
+        "\" for reading.";
+    throw CSVFileException(msg);
+  }
+
+  // Detect format from magic bytes rather than trusting the extension.
+  QByteArray magic = inFile.peek(4);
+  if (magic.startsWith("\x1f\x8b"))
+    inputFormat = Gzip;
+  else if (magic == QByteArray("\x28\xb5\x2f\xfd", 4))
+    inputFormat = Zstd;
+  else
+    inputFormat = Plain;
+}
+
+/*
+ * Method: nextChunk
+ */
+const DecompressionStage::Chunk *DecompressionStage::nextChunk()
+    throw(CSVFileException)
+{
+  QMutexLocker locker(&mutex);
+  while (filledChunks.isEmpty() && !finished)
+    chunkFilled.wait(&mutex);
+
+  if (!filledChunks.isEmpty())
+    return filledChunks.dequeue();
+
+  if (!errorMessage.isEmpty())
+    throw CSVFileException(errorMessage.toStdString());
+
+  return 0;
+}
+
+/*
+ * Method: releaseChunk
+ */
+void DecompressionStage::releaseChunk(const Chunk *chunk)
+{
+  QMutexLocker locker(&mutex);
+  freeChunks.enqueue(const_cast<Chunk*>(chunk));
+  chunkFreed.wakeOne();
+}
+
+/*
+ * Method: cancel
+ */
+void DecompressionStage::cancel()
+{
+  QMutexLocker locker(&mutex);
+  cancelled = true;
+  chunkFreed.wakeAll();
+}
+
+/*
+ * Method: run
+ */
+void DecompressionStage::run()
+{
+  QString error;
+  switch (inputFormat)
+  {
+    case Gzip:
+      error = readGzip();
+      break;
+    case Zstd:
+      error = readZstd();
+      break;
+    default:
+      error = readPlain();
+      break;
+  }
+
+  QMutexLocker locker(&mutex);
+  errorMessage = error;
+  finished = true;
+  chunkFilled.wakeAll();
+}
+
+/*
+ * Method: acquireChunk
+ */
+DecompressionStage::Chunk *DecompressionStage::acquireChunk()
+{
+  QMutexLocker locker(&mutex);
+  while (freeChunks.isEmpty() && !cancelled)
+    chunkFreed.wait(&mutex);
+
+  if (cancelled)
+    return 0;
+
+  Chunk *chunk = freeChunks.dequeue();
+  chunk->length = 0;
+  return chunk;
+}
+
+/*
+ * Method: publishChunk
+ */
+void DecompressionStage::publishChunk(Chunk *chunk)
+{
+  QMutexLocker locker(&mutex);
+  if (chunk->length > 0)
+  {
+    filledChunks.enqueue(chunk);
+    chunkFilled.wakeOne();
+  }
+  else
+  {
+    freeChunks.enqueue(chunk);
+  }
+}
+
+/*
+ * Method: readPlain
+ */
+QString DecompressionStage::readPlain()
+{
+  Chunk *chunk;
+  while ((chunk = acquireChunk()) != 0)
+  {
+    qint64 count = inFile.read(chunk->buffer.data(), ChunkSize);
+    if (count < 0)
+    {
+      publishChunk(chunk);
+      return "Error reading file \"" + fileName + "\".";
+    }
+
+    chunk->length = int(count);
+    publishChunk(chunk);
+    if (count == 0)
+      break;
+  }
+  return QString();
+}
+
+/*
+ * Method: readGzip
+ */
+QString DecompressionStage::readGzip()
+{
+  QByteArray input(InputSize, 0);
+  z_stream stream;
+  stream.zalloc = Z_NULL;
+  stream.zfree = Z_NULL;
+  stream.opaque = Z_NULL;
+  stream.next_in = Z_NULL;
+  stream.avail_in = 0;
+
+  // Window bits of 15 + 32 accepts both gzip and zlib headers.
+  if (inflateInit2(&stream, 15 + 32) != Z_OK)
+    return "Cannot initialize gzip decompression.";
+
+  QString error;
+  Chunk *chunk = acquireChunk();
+  bool outputFull = false;
+  bool memberOpen = false;
+  while (chunk)
+  {
+    // Refill compressed input only once pending output has been drained.
+    if (stream.avail_in == 0 && !outputFull)
+    {
+      qint64 count = inFile.read(input.data(), InputSize);
+      if (count < 0)
+      {
+        error = "Error reading file \"" + fileName + "\".";
+        break;
+      }
+      if (count == 0)
+      {
+        if (memberOpen)
+          error = "File \"" + fileName + "\" is truncated.";
+        break;
+      }
+      stream.next_in = reinterpret_cast<Bytef*>(input.data());
+      stream.avail_in = uInt(count);
+    }
+
+    stream.next_out = reinterpret_cast<Bytef*>(chunk->buffer.data() +
+                                               chunk->length);
+    stream.avail_out = uInt(ChunkSize - chunk->length);
+    int status = inflate(&stream, Z_NO_FLUSH);
+    chunk->length = ChunkSize - int(stream.avail_out);
+    outputFull = (stream.avail_out == 0);
+
+    if (status == Z_STREAM_END)
+    {
+      // Concatenated gzip members are valid; continue with the next one.
+      inflateReset(&stream);
+      memberOpen = false;
+    }
+    else if (status == Z_OK || status == Z_BUF_ERROR)
+    {
+      memberOpen = true;
+    }
+    else
+    {
+      error = "File \"" + fileName + "\" is not valid gzip data.";
+      break;
+    }
+
+    if (outputFull)
+    {
+      publishChunk(chunk);
+      chunk = acquireChunk();
+    }
+  }
+
+  if (chunk)
+    publishChunk(chunk);
+  inflateEnd(&stream);
+  return error;
+}
+
+/*
+ * Method: readZstd
+ */
+QString DecompressionStage::readZstd()
+{
+#ifdef HAVE_ZSTD
+  QByteArray input(InputSize, 0);
+  ZSTD_DStream *stream = ZSTD_createDStream();
+  if (!stream || ZSTD_isError(ZSTD_initDStream(stream)))
+  {
+    ZSTD_freeDStream(stream);
+    return "Cannot initialize zstd decompression.";
+  }
+
+  QString error;
+  ZSTD_inBuffer in = { input.constData(), 0, 0 };
+  Chunk *chunk = acquireChunk();
+  bool outputFull = false;
+  size_t status = 0;
+  while (chunk)
+  {
+    // Refill compressed input only once pending output has been drained.
+    if (in.pos == in.size && !outputFull)
+    {
+      qint64 count = inFile.read(input.data(), InputSize);
+      if (count < 0)
+      {
+        error = "Error reading file \"" + fileName + "\".";
+        break;
+      }
+      if (count == 0)
+      {
+        // A non-zero hint means the last frame was not completed.
+        if (status != 0)
+          error = "File \"" + fileName + "\" is truncated.";
+        break;
+      }
+      in.size = size_t(count);
+      in.pos = 0;
+    }
+
+    ZSTD_outBuffer out = { chunk->buffer.data(), size_t(ChunkSize),
+                           size_t(chunk->length) };
+    status = ZSTD_decompressStream(stream, &out, &in);
+    chunk->length = int(out.pos);
+    outputFull = (out.pos == out.size);
+    if (ZSTD_isError(status))
+    {
+      error = "File \"" + fileName + "\" is not valid zstd data.";
+      break;
+    }
+
+    if (outputFull)
+    {
+      publishChunk(chunk);
+      chunk = acquireChunk();
+    }
+  }
+
+  if (chunk)
+    publishChunk(chunk);
+  ZSTD_freeDStream(stream);
+  return error;
+#else
+  return "File \"" + fileName + "\" is zstd compressed, but zstd support "
+      "was not built in.";
+#endif
+}
@@ -0,0 +1,175 @@
+/*
+ * DecompressionStage.h: Producer stage of the CSV file reading pipeline;
+ *                     : reads (and, if required, decompresses) a file on its
+ *                     : own thread into a ring of fixed-size chunks.
+ * Author: B. D. Knopp: bdknopp@users.noreply.github.com
+ * Version: 1.00: Initial implementation; plain, gzip and zstd input.
+ * Date: 19 October 2026
+ */
+
+#ifndef DECOMPRESSIONSTAGE_H
+#define DECOMPRESSIONSTAGE_H
+
+/* C++ includes. */
+#include <exception>
+#include <string>
+
+/* Qt includes. */
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+
+/* Project includes. */
+#include "CSVFileException.h"
+
+/*
+ * Class: DecompressionStage
+ * Description: Reads a (possibly compressed) file on a worker thread into a
+ *            : fixed pool of chunk buffers.  The consuming thread takes
+ *            : filled chunks in file order, parses them, and hands them
+ *            : back, so that decompression and parsing overlap and memory
+ *            : use is bounded by the pool size.
+ */
+class DecompressionStage : public QThread
+{
+  Q_OBJECT
+
+  /* Public types. */
+  public:
+    /*
+     * Enum: Format
+     * Description: Container format of the input file.
+     */
+    enum Format { Plain, Gzip, Zstd };
+
+    /*
+     * Struct: Chunk
+     * Description: One buffer of decompressed file contents.
+     */
+    struct Chunk
+    {
+      QByteArray buffer;
+      int length;
+    };
+
+    // Size of each decompressed chunk, and number of chunks in the pool.
+    static const int ChunkSize = 1 << 20;
+    static const int ChunkCount = 4;
+
+  /* Public methods. */
+  public:
+    /*
+     * Constructor: DecompressionStage
+     * Description: Creates a stage for the named file; does not open it.
+     * Parameters: fName: Name of file to read.
+     *           : parent: Parent object to associate with; default 0.
+     */
+    explicit DecompressionStage(QString fName, QObject *parent = 0);
+
+    /*
+     * Destructor: ~DecompressionStage
+     * Description: Cancels and waits for the worker thread, if running.
+     */
+    ~DecompressionStage();
+
+    /*
+     * Method: open
+     * Description: Opens the file and detects its format from the leading
+     *            : magic bytes.  Must be called before start().
+     * Parameters: none.
+     * Returns: none.
+     */
+    void open() throw(CSVFileException);
+
+    /*
+     * Method: format
+     * Description: Retrieves the format detected by open().
+     * Parameters: none.
+     * Returns: Input file format.
+     */
+    Format format() const { return inputFormat; }
+
+    /*
+     * Method: nextChunk
+     * Description: Waits for the next chunk of file contents.  The chunk
+     *            : remains valid until passed back to releaseChunk().
+     * Parameters: none.
+     * Returns: Next chunk in file order; 0 once the file is exhausted.
+     */
+    const Chunk *nextChunk() throw(CSVFileException);
+
+    /*
+     * Method: releaseChunk
+     * Description: Returns a consumed chunk to the pool for reuse.
+     * Parameters: chunk: Chunk previously returned by nextChunk().
+     * Returns: none.
+     */
+    void releaseChunk(const Chunk *chunk);
+
+    /*
+     * Method: cancel
+     * Description: Asks the worker thread to stop at the next chunk.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void cancel();
+
+  /* Protected methods. */
+  protected:
+    /*
+     * Method: run
+     * Description: Worker thread body; fills chunks until end of file.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void run();
+
+  /* Private members. */
+  private:
+    /*
+     * Method: acquireChunk
+     * Description: Waits for a free chunk to fill.
+     * Parameters: none.
+     * Returns: Empty chunk; 0 if cancelled.
+     */
+    Chunk *acquireChunk();
+
+    /*
+     * Method: publishChunk
+     * Description: Queues a filled chunk for the consumer.
+     * Parameters: chunk: Chunk to queue; dropped if empty.
+     * Returns: none.
+     */
+    void publishChunk(Chunk *chunk);
+
+    /*
+     * Methods: readPlain, readGzip, readZstd
+     * Description: Format-specific fill loops run by the worker thread.
+     * Parameters: none.
+     * Returns: Error message; empty on success.
+     */
+    QString readPlain();
+    QString readGzip();
+    QString readZstd();
+
+    QString fileName;
+    QFile inFile;
+    Format inputFormat;
+
+    // Chunk pool and hand-off queues; guarded by mutex.
+    Chunk chunks[ChunkCount];
+    QQueue<Chunk*> filledChunks;
+    QQueue<Chunk*> freeChunks;
+    QMutex mutex;
+    QWaitCondition chunkFilled;
+    QWaitCondition chunkFreed;
+    bool finished;
+    bool cancelled;
+    QString errorMessage;
+};
+
+#endif // DECOMPRESSIONSTAGE_H
@@ -0,0 +1,481 @@
+/*
+ * DerivedSeries.cpp: See "DerivedSeries.h" for documentation.
+ */
+
+#include "DerivedSeries.h"
+
+/* C includes. */
+#include <cmath>
+#include <cstring>
+
+/* Qt includes. */
+#include <QtConcurrent>
+
+/*
+ * Constructor: DerivedSeries
+ */
+DerivedSeries::DerivedSeries(CSVDataModel *model, Kind kind, double parameter,
+                             QObject *parent) :
+  QObject(parent),
+  model(model),
+  kind(kind),
+  window(qMax(1, int(parameter))),
+  interval((parameter > 0.0) ? parameter : 1.0),
+  samplesValid(false)
+{
+  connect(model, &QAbstractItemModel::dataChanged,
+          this, &DerivedSeries::sourceDataChanged);
+  connect(model, &QAbstractItemModel::rowsInserted,
+          this, &DerivedSeries::sourceRowsChanged);
+  connect(model, &QAbstractItemModel::rowsRemoved,
+          this, &DerivedSeries::sourceRowsRemoved);
+  connect(model, &QAbstractItemModel::modelReset,
+          this, &DerivedSeries::sourceReset);
+  connect(model, &QAbstractItemModel::layoutChanged,
+          this, &DerivedSeries::sourceReset);
+}
+
+/*
+ * Method: name
+ */
+QString DerivedSeries::name() const
+{
+  switch (kind)
+  {
+    case RollingMean:
+      return QString("Mean(%1)").arg(window);
+    case RollingMinimum:
+      return QString("Min(%1)").arg(window);
+    case RollingMaximum:
+      return QString("Max(%1)").arg(window);
+    case Resample:
+      if (model->xTimeFormat() != TimestampParser::None)
+        return "Resample(" + TimestampParser::durationText(interval) + ")";
+      return "Resample(" + QString::number(interval) + ")";
+    default:
+      return "Difference";
+  }
+}
+
+/*
+ * Method: update
+ */
+void DerivedSeries::update()
+{
+  const DataColumn &xColumn = model->xColumn();
+  int count = xColumn.blockCount();
+  if (valid.size() != count)
+    sourceReset();
+
+  // Group runs of discarded blocks into tasks.
+  int taskRows = qMax(int(TaskRows), 4 * window);
+  QVector<Task> tasks;
+  for (int b = 0; b < count; b++)
+  {
+    if (valid.at(b))
+      continue;
+
+    if (!tasks.isEmpty() && (tasks.last().lastBlock == b - 1) &&
+        (xColumn.blockStart(b) -
+         xColumn.blockStart(tasks.last().firstBlock) < taskRows))
+    {
+      tasks.last().lastBlock = b;
+    }
+    else
+    {
+      Task task;
+      task.firstBlock = task.lastBlock = b;
+      tasks.append(task);
+    }
+  }
+
+  if (!tasks.isEmpty())
+  {
+    QtConcurrent::blockingMap(tasks, [this](Task &task) { compute(task); });
+
+    for (int t = 0; t < tasks.size(); t++)
+    {
+      const Task &task = tasks.at(t);
+      for (int b = task.firstBlock; b <= task.lastBlock; b++)
+      {
+        int i = b - task.firstBlock;
+        if (kind == Resample)
+        {
+          bins[b] = task.bins.at(i);
+        }
+        else
+        {
+          values[b] = task.values.at(i);
+          stats[b] = task.stats.at(i);
+        }
+        valid[b] = true;
+      }
+    }
+  }
+
+  if ((kind != Resample) || samplesValid)
+    return;
+
+  // Merge the per-block bins into one point per interval.
+  QMap<qint64, Bin> merged;
+  for (int b = 0; b < count; b++)
+  {
+    const QVector<Bin> &blockBins = bins.at(b);
+    for (int i = 0; i < blockBins.size(); i++)
+    {
+      const Bin &bin = blockBins.at(i);
+      QMap<qint64, Bin>::iterator it = merged.find(bin.index);
+      if (it == merged.end())
+      {
+        merged.insert(bin.index, bin);
+      }
+      else
+      {
+        it->sum += bin.sum;
+        it->count += bin.count;
+      }
+    }
+  }
+
+  sampleX.clear();
+  sampleY.clear();
+  QMap<qint64, Bin>::const_iterator it;
+  for (it = merged.constBegin(); it != merged.constEnd(); ++it)
+  {
+    sampleX.append((double(it->index) + 0.5) * interval);
+    sampleY.append(it->sum / it->count);
+  }
+  samplesValid = true;
+}
+
+/*
+ * Method: blockStart
+ */
+int DerivedSeries::blockStart(int block) const
+{
+  return model->xColumn().blockStart(block);
+}
+
+/*
+ * Method: blockData
+ */
+const double *DerivedSeries::blockData(int block, double *) const
+{
+  return values.at(block).constData();
+}
+
+/*
+ * Method: read
+ */
+void DerivedSeries::read(int row, int count, double *out) const
+{
+  int block = model->xColumn().findBlock(row);
+  while ((count > 0) && (block < values.size()))
+  {
+    int offset = row - blockStart(block);
+    int n = qMin(count, blockLength(block) - offset);
+    memcpy(out, values.at(block).constData() + offset, n * sizeof(double));
+    out += n;
+    row += n;
+    count -= n;
+    block++;
+  }
+}
+
+/*
+ * Method: minimum
+ */
+double DerivedSeries::minimum() const
+{
+  if (kind == Resample)
+    return sampleY.minimum();
+
+  double result = NAN;
+  for (int b = 0; b < stats.size(); b++)
+  {
+    if (!(stats.at(b).minimum >= result))
+      result = stats.at(b).minimum;
+  }
+  return result;
+}
+
+/*
+ * Method: maximum
+ */
+double DerivedSeries::maximum() const
+{
+  if (kind == Resample)
+    return sampleY.maximum();
+
+  double result = NAN;
+  for (int b = 0; b < stats.size(); b++)
+  {
+    if (!(stats.at(b).maximum <= result))
+      result = stats.at(b).maximum;
+  }
+  return result;
+}
+
+/*
+ * Method: sourceDataChanged
+ */
+void DerivedSeries::sourceDataChanged(const QModelIndex &topLeft,
+                                      const QModelIndex &bottomRight)
+{
+  // Rolling and difference series depend on Y alone.
+  if ((kind != Resample) && (bottomRight.column() < 1))
+    return;
+
+  const DataColumn &xColumn = model->xColumn();
+  if (xColumn.size() == 0)
+    return;
+
+  int last = int(qMin(qint64(bottomRight.row()) + reach(),
+                      qint64(xColumn.size() - 1)));
+  invalidate(xColumn.findBlock(topLeft.row()), xColumn.findBlock(last));
+}
+
+/*
+ * Method: sourceRowsChanged
+ */
+void DerivedSeries::sourceRowsChanged(const QModelIndex &parent, int first,
+                                      int)
+{
+  if (parent.isValid())
+    return;
+
+  // Blocks before the one now holding the first row are unchanged, and
+  // trailing windows never look forward.
+  const DataColumn &xColumn = model->xColumn();
+  int count = xColumn.blockCount();
+  int keep = 0;
+  if (xColumn.size() > 0)
+    keep = qMin(xColumn.findBlock(qMin(first, xColumn.size() - 1)),
+                valid.size());
+
+  values.resize(keep);
+  stats.resize(keep);
+  bins.resize(keep);
+  valid.resize(keep);
+
+  values.resize(count);
+  stats.resize(count);
+  bins.resize(count);
+  valid.resize(count);
+  invalidate(keep, count - 1);
+}
+
+/*
+ * Method: sourceRowsRemoved
+ */
+void DerivedSeries::sourceRowsRemoved(const QModelIndex &parent, int first,
+                                      int)
+{
+  if (parent.isValid())
+    return;
+
+  // Removal drops the blocks it covers whole and trims the others in place,
+  //   so the blocks after it keep their results, moved down.
+  const DataColumn &xColumn = model->xColumn();
+  int dropped = valid.size() - xColumn.blockCount();
+  if ((xColumn.size() == 0) || (dropped < 0))
+  {
+    sourceReset();
+    return;
+  }
+
+  int start = xColumn.findBlock(qMax(first - 1, 0));
+  values.remove(start, dropped);
+  stats.remove(start, dropped);
+  bins.remove(start, dropped);
+  valid.remove(start, dropped);
+
+  // Trimmed blocks, and the windows reaching across the removed rows.
+  int last = int(qMin(qint64(first) + reach(), qint64(xColumn.size() - 1)));
+  invalidate(start, xColumn.findBlock(last));
+}
+
+/*
+ * Method: sourceReset
+ */
+void DerivedSeries::sourceReset()
+{
+  int count = model->xColumn().blockCount();
+  values.clear();
+  stats.clear();
+  bins.clear();
+  valid.clear();
+
+  values.resize(count);
+  stats.resize(count);
+  bins.resize(count);
+  valid.resize(count);
+  invalidate(0, count - 1);
+}
+
+/*
+ * Method: compute
+ */
+void DerivedSeries::compute(Task &task) const
+{
+  const DataColumn &xColumn = model->xColumn();
+  const DataColumn &yColumn = model->yColumn();
+  int first = xColumn.blockStart(task.firstBlock);
+  int end = xColumn.blockStart(task.lastBlock) +
+      xColumn.blockLength(task.lastBlock);
+  int blocks = task.lastBlock - task.firstBlock + 1;
+
+  if (kind == Resample)
+  {
+    QVector<double> xs(end - first), ys(end - first);
+    xColumn.read(first, xs.size(), xs.data());
+    yColumn.read(first, ys.size(), ys.data());
+
+    task.bins.resize(blocks);
+    for (int i = 0; i < blocks; i++)
+    {
+      int start = xColumn.blockStart(task.firstBlock + i) - first;
+      int length = xColumn.blockLength(task.firstBlock + i);
+
+      QMap<qint64, Bin> blockBins;
+      for (int j = start; j < start + length; j++)
+      {
+        double position = std::floor(xs.at(j) / interval);
+        if (!std::isfinite(ys.at(j)) || !(std::fabs(position) < 9e18))
+          continue;
+
+        qint64 index = qint64(position);
+        Bin &bin = blockBins[index];
+        if (bin.count == 0)
+        {
+          bin.index = index;
+          bin.sum = 0.0;
+        }
+        bin.sum += ys.at(j);
+        bin.count++;
+      }
+
+      QVector<Bin> &out = task.bins[i];
+      out.reserve(blockBins.size());
+      QMap<qint64, Bin>::const_iterator it;
+      for (it = blockBins.constBegin(); it != blockBins.constEnd(); ++it)
+        out.append(it.value());
+    }
+    return;
+  }
+
+  // Read the rows filling the first window along with the task's own.
+  int lead = (kind == Difference) ? qMin(first, 1) : qMin(first, window - 1);
+  QVector<double> input(end - first + lead);
+  yColumn.read(first - lead, input.size(), input.data());
+
+  QVector<double> output(end - first);
+  if (kind == Difference)
+  {
+    for (int i = 0; i < output.size(); i++)
+    {
+      int j = i + lead;
+      output[i] = (j > 0) ? (input.at(j) - input.at(j - 1)) : NAN;
+    }
+  }
+  else
+  {
+    rollWindow(input.constData(), input.size(), lead, output.data());
+  }
+
+  task.values.resize(blocks);
+  task.stats.resize(blocks);
+  for (int i = 0; i < blocks; i++)
+  {
+    int start = xColumn.blockStart(task.firstBlock + i) - first;
+    int length = xColumn.blockLength(task.firstBlock + i);
+    task.values[i] = output.mid(start, length);
+    task.stats[i] = DataColumn::summarize(task.values.at(i).constData(),
+                                          length);
+  }
+}
+
+/*
+ * Method: rollWindow
+ */
+void DerivedSeries::rollWindow(const double *input, int count, int lead,
+                               double *output) const
+{
+  if (kind == RollingMean)
+  {
+    double sum = 0.0;
+    int finite = 0;
+    for (int i = 0; i < count; i++)
+    {
+      if (std::isfinite(input[i]))
+      {
+        sum += input[i];
+        finite++;
+      }
+      if ((i >= window) && std::isfinite(input[i - window]))
+      {
+        sum -= input[i - window];
+        finite--;
+      }
+
+      // Drop rounding residue whenever the window empties.
+      if (finite == 0)
+        sum = 0.0;
+      if (i >= lead)
+        output[i - lead] = (finite > 0) ? (sum / finite) : NAN;
+    }
+    return;
+  }
+
+  // Indices of candidate extremes, their values strictly improving from
+  // head to tail; each index enters and leaves at most once.
+  QVector<int> queue(count);
+  int *indices = queue.data();
+  int head = 0, tail = 0;
+  bool minimum = (kind == RollingMinimum);
+  for (int i = 0; i < count; i++)
+  {
+    double v = input[i];
+    if (std::isfinite(v))
+    {
+      while ((tail > head) && (minimum ? (input[indices[tail - 1]] >= v)
+                                       : (input[indices[tail - 1]] <= v)))
+        tail--;
+      indices[tail++] = i;
+    }
+    while ((tail > head) && (indices[head] <= i - window))
+      head++;
+
+    if (i >= lead)
+      output[i - lead] = (tail > head) ? input[indices[head]] : NAN;
+  }
+}
+
+/*
+ * Method: reach
+ */
+int DerivedSeries::reach() const
+{
+  if ((kind == RollingMean) || (kind == RollingMinimum) ||
+      (kind == RollingMaximum))
+    return window - 1;
+  else if (kind == Difference)
+    return 1;
+  return 0;
+}
+
+/*
+ * Method: invalidate
+ */
+void DerivedSeries::invalidate(int firstBlock, int lastBlock)
+{
+  for (int b = qMax(firstBlock, 0); b <= lastBlock; b++)
+  {
+    if (b >= valid.size())
+      break;
+    valid[b] = false;
+    if (kind == Resample)
+      bins[b].clear();
+  }
+  samplesValid = false;
+}
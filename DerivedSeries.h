@@ -0,0 +1,260 @@
+/*
+ * DerivedSeries.h: Series computed from the data model (rolling statistics,
+ *                : resampling, differences) for drawing as graph overlays.
+ * Author: B. D. Knopp: bdknopp@users.noreply.github.com
+ * Version: 1.00: Initial implementation.
+ * Date: 19 October 2026
+ */
+
+#ifndef DERIVEDSERIES_H
+#define DERIVEDSERIES_H
+
+/* Qt includes. */
+#include <QObject>
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+/* Project includes. */
+#include "CSVDataModel.h"
+#include "DataColumn.h"
+
+/*
+ * Class: DerivedSeries
+ * Description: A series derived from the Y column of a CSVDataModel.  Values
+ *            : are computed lazily, by update(), in tasks of consecutive
+ *            : blocks run in parallel, and cached per block of the model's
+ *            : columns.  Model changes only discard the blocks they can
+ *            : affect: an edit invalidates the blocks whose trailing window
+ *            : covers it, an insertion the blocks from it on, and a removal
+ *            : only the blocks it trims and those whose windows reach
+ *            : across it.
+ *            :
+ *            : Rolling and difference series have one value per model row
+ *            : and share the model's X column; a resampled series has its
+ *            : own X and Y columns, one point per occupied interval.
+ */
+class DerivedSeries : public QObject
+{
+  Q_OBJECT
+
+  /* Public types. */
+  public:
+    /*
+     * Enum: Kind
+     * Description: Computation performed.  Rolling windows are trailing and
+     *            : skip empty cells; Resample averages Y over fixed X
+     *            : intervals; Difference is the first difference of Y.
+     */
+    enum Kind { RollingMean, RollingMinimum, RollingMaximum, Resample,
+                Difference };
+
+    // Rows computed per parallel task, at least; tasks also span several
+    // windows so that reading each window's lead-in stays a small overhead.
+    static const int TaskRows = 65536;
+
+  /* Public methods. */
+  public:
+    /*
+     * Constructor: DerivedSeries
+     * Description: Creates a series over a model; nothing is computed until
+     *            : update() is called.
+     * Parameters: model: Model providing the source data.
+     *           : kind: Computation performed.
+     *           : parameter: Window length in rows for rolling series, or
+     *           :          : interval in X units (seconds for timestamps)
+     *           :          : for Resample; ignored for Difference.
+     *           : parent: Parent object to associate with; default 0.
+     */
+    DerivedSeries(CSVDataModel *model, Kind kind, double parameter,
+                  QObject *parent = 0);
+
+    /*
+     * Method: name
+     * Description: Describes the series for display, e.g. "Mean(10)".
+     * Parameters: none.
+     * Returns: Series name.
+     */
+    QString name() const;
+
+    /*
+     * Method: isRowAligned
+     * Description: Determines if the series has one value per model row.
+     * Parameters: none.
+     * Returns: True for rolling and difference series; false for Resample.
+     */
+    bool isRowAligned() const { return kind != Resample; }
+
+    /*
+     * Method: update
+     * Description: Computes any values discarded since the last update.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void update();
+
+    /*
+     * Methods: blockCount, blockStart, blockLength, blockStats, blockData
+     * Description: Block accessors for row-aligned series, matching those of
+     *            : DataColumn and the blocks of the model's X column.  Only
+     *            : valid after update().
+     * Parameters: block: Index of block.
+     *           : scratch: Unused; values are always held decoded.
+     * Returns: Count, first row, length, statistics, or values of block.
+     */
+    int blockCount() const { return values.size(); }
+    int blockStart(int block) const;
+    int blockLength(int block) const { return values.at(block).size(); }
+    const DataColumn::BlockStats &blockStats(int block) const
+    {
+      return stats.at(block);
+    }
+    const double *blockData(int block, double *scratch) const;
+
+    /*
+     * Method: read
+     * Description: Copies a range of values of a row-aligned series out.
+     * Parameters: row: First row to read.
+     *           : count: Number of rows to read.
+     *           : out: Receives count values.
+     * Returns: none.
+     */
+    void read(int row, int count, double *out) const;
+
+    /*
+     * Methods: resampledX, resampledY
+     * Description: Retrieves the points of a Resample series, in ascending
+     *            : X order.  Only valid after update().
+     * Parameters: none.
+     * Returns: Interval centres or mean Y values.
+     */
+    const DataColumn &resampledX() const { return sampleX; }
+    const DataColumn &resampledY() const { return sampleY; }
+
+    /*
+     * Methods: minimum, maximum
+     * Description: Retrieves the extremes of the finite Y values.  Only valid
+     *            : after update().
+     * Parameters: none.
+     * Returns: Minimum or maximum; NaN if there are no finite values.
+     */
+    double minimum() const;
+    double maximum() const;
+
+  /* Private types. */
+  private:
+    // Sum and count of the Y values in one resample interval.
+    struct Bin
+    {
+      qint64 index;
+      double sum;
+      int count;
+    };
+
+    // Consecutive blocks computed together, and their results.
+    struct Task
+    {
+      int firstBlock, lastBlock;
+      QVector<QVector<double> > values;
+      QVector<DataColumn::BlockStats> stats;
+      QVector<QVector<Bin> > bins;
+    };
+
+  /* Private slots. */
+  private slots:
+    /*
+     * Method: sourceDataChanged
+     * Description: Discards the blocks affected by edited cells.
+     * Parameters: topLeft, bottomRight: Range of edited cells.
+     * Returns: none.
+     */
+    void sourceDataChanged(const QModelIndex &topLeft,
+                           const QModelIndex &bottomRight);
+
+    /*
+     * Method: sourceRowsChanged
+     * Description: Discards the blocks from inserted rows on.
+     * Parameters: parent: Parent index.
+     *           : first, last: Range of rows inserted.
+     * Returns: none.
+     */
+    void sourceRowsChanged(const QModelIndex &parent, int first, int last);
+
+    /*
+     * Method: sourceRowsRemoved
+     * Description: Drops the blocks of removed rows and moves the results
+     *            : of those following down, so rows evicted from the front
+     *            : discard only the trimmed block and the windows reaching
+     *            : past it.
+     * Parameters: parent: Parent index.
+     *           : first, last: Range of rows removed.
+     * Returns: none.
+     */
+    void sourceRowsRemoved(const QModelIndex &parent, int first, int last);
+
+    /*
+     * Method: sourceReset
+     * Description: Discards all cached values.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void sourceReset();
+
+  /* Private members. */
+  private:
+    /*
+     * Method: compute
+     * Description: Computes the values of a task's blocks.  Reads the model
+     *            : columns only, so tasks may run concurrently.
+     * Parameters: task: Task to compute; receives its results.
+     * Returns: none.
+     */
+    void compute(Task &task) const;
+
+    /*
+     * Method: rollWindow
+     * Description: Computes a rolling statistic in O(count) time: a running
+     *            : sum for means, a monotonic queue for minima and maxima.
+     * Parameters: input: Source values, starting lead rows before output.
+     *           : count: Number of source values.
+     *           : lead: Number of leading values that only fill the window.
+     *           : output: Receives count - lead values.
+     * Returns: none.
+     */
+    void rollWindow(const double *input, int count, int lead,
+                    double *output) const;
+
+    /*
+     * Method: reach
+     * Description: Determines how many following rows a value reaches, in
+     *            : their windows or differences.
+     * Parameters: none.
+     * Returns: Number of rows.
+     */
+    int reach() const;
+
+    /*
+     * Method: invalidate
+     * Description: Discards a range of blocks.
+     * Parameters: firstBlock, lastBlock: Range of blocks.
+     * Returns: none.
+     */
+    void invalidate(int firstBlock, int lastBlock);
+
+    CSVDataModel *model;
+    Kind kind;
+    int window;
+    double interval;
+
+    // Cached results per block of the model's columns.
+    QVector<QVector<double> > values;
+    QVector<DataColumn::BlockStats> stats;
+    QVector<QVector<Bin> > bins;
+    QVector<bool> valid;
+
+    // Resampled points; rebuilt from the bins when any block changes.
+    DataColumn sampleX, sampleY;
+    bool samplesValid;
+};
+
+#endif // DERIVEDSERIES_H
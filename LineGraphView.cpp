@@ -4,13 +4,108 @@
 
 #include "LineGraphView.h"
 
+/* Qt includes. */
+#include <QFileInfo>
+#include <QFontMetrics>
+#include <QGuiApplication>
+#include <QImage>
+#include <QPageSize>
+#include <QPdfWriter>
+#include <QScreen>
+#include <QSvgGenerator>
+
+/*
+ * Procedure: addPoint
+ * Description: Accumulates a point into a pixel bucket.
+ * Parameters: bucket: Bucket to update.
+ *           : x, y: Point coordinates.
+ * Returns: none.
+ */
+static inline void addPoint(PixelBucket &bucket, double x, double y)
+{
+  if (!bucket.used)
+  {
+    bucket.used = true;
+    bucket.firstX = bucket.lastX = bucket.lowX = bucket.highX = x;
+    bucket.firstY = bucket.lastY = bucket.lowY = bucket.highY = y;
+    return;
+  }
+
+  if (x < bucket.firstX)
+  {
+    bucket.firstX = x;
+    bucket.firstY = y;
+  }
+  if (x >= bucket.lastX)
+  {
+    bucket.lastX = x;
+    bucket.lastY = y;
+  }
+  if (y < bucket.lowY)
+  {
+    bucket.lowX = x;
+    bucket.lowY = y;
+  }
+  if (y > bucket.highY)
+  {
+    bucket.highX = x;
+    bucket.highY = y;
+  }
+}
+
+/*
+ * Procedure: bucketBounds
+ * Description: Widens bounds to include the points of used pixel buckets.
+ * Parameters: buckets: Buckets to include.
+ *           : minX, maxX, minY, maxY: Bounds to widen; NaN if unset.
+ * Returns: none.
+ */
+static void bucketBounds(const QVector<PixelBucket> &buckets, double *minX,
+                         double *maxX, double *minY, double *maxY)
+{
+  for (int i = 0; i < buckets.size(); i++)
+  {
+    const PixelBucket &bucket = buckets.at(i);
+    if (!bucket.used)
+      continue;
+    if ((bucket.firstX < *minX) || (*minX != *minX))
+      *minX = bucket.firstX;
+    if ((bucket.lastX > *maxX) || (*maxX != *maxX))
+      *maxX = bucket.lastX;
+    if ((bucket.lowY < *minY) || (*minY != *minY))
+      *minY = bucket.lowY;
+    if ((bucket.highY > *maxY) || (*maxY != *maxY))
+      *maxY = bucket.highY;
+  }
+}
+
 /*
  * Constructor: LineGraphView
  */
 LineGraphView::LineGraphView(QWidget *parent) :
   QAbstractItemView(parent),
-  scene(new QGraphicsScene())
+  view(0),
+  scene(new QGraphicsScene()),
+  xLabel(0),
+  yLabel(0),
+  dataModel(0),
+  filterModel(0),
+  bucketsValid(false),
+  bucketColumns(0),
+  bucketMinX(0.0),
+  bucketScale(0.0),
+  bucketOffset(0),
+  bucketLastX(0.0),
+  bucketsAscending(false),
+  bucketedRows(0),
+  evictedRows(0)
 {
+  // Redraw at most once per display frame, however often rows arrive.
+  QScreen *screen = QGuiApplication::primaryScreen();
+  qreal rate = screen ? screen->refreshRate() : 60.0;
+  redrawTimer.setSingleShot(true);
+  redrawTimer.setInterval(qMax(1, int(1000.0 / qMax(rate, qreal(1.0)))));
+  connect(&redrawTimer, &QTimer::timeout, this, &LineGraphView::redrawPath);
 }
 
 /*
@@ -41,6 +136,87 @@ void LineGraphView::setLabels(QLabel *xLabel, QLabel *yLabel)
   this->yLabel = yLabel;
 }
 
+/*
+ * Method: setModel
+ */
+void LineGraphView::setModel(QAbstractItemModel *model)
+{
+  QAbstractItemView::setModel(model);
+  filterModel = qobject_cast<RowFilterProxyModel*>(model);
+  dataModel = filterModel ? filterModel->dataModel()
+                          : qobject_cast<CSVDataModel*>(model);
+
+  // Axes and overlays follow all rows, including those filtered out.
+  if (filterModel && dataModel)
+  {
+    connect(dataModel, &QAbstractItemModel::dataChanged,
+            this, &LineGraphView::scheduleRedraw);
+    connect(dataModel, &QAbstractItemModel::rowsInserted,
+            this, &LineGraphView::scheduleRedraw);
+    connect(dataModel, &QAbstractItemModel::rowsRemoved,
+            this, &LineGraphView::scheduleRedraw);
+  }
+
+  // The buckets drawn follow rows appended to and evicted from the model.
+  bucketsValid = false;
+  if (dataModel)
+  {
+    connect(dataModel, &QAbstractItemModel::rowsInserted,
+            this, &LineGraphView::dataRowsInserted);
+    connect(dataModel, &QAbstractItemModel::rowsRemoved,
+            this, &LineGraphView::dataRowsRemoved);
+    connect(dataModel, &QAbstractItemModel::dataChanged,
+            this, &LineGraphView::invalidateBuckets);
+    connect(dataModel, &QAbstractItemModel::modelReset,
+            this, &LineGraphView::invalidateBuckets);
+    connect(dataModel, &QAbstractItemModel::layoutChanged,
+            this, &LineGraphView::invalidateBuckets);
+  }
+
+  // Neither signal has a virtual handler in QAbstractItemView.
+  if (model)
+  {
+    connect(model, &QAbstractItemModel::layoutChanged,
+            this, &LineGraphView::scheduleRedraw);
+    connect(model, &QAbstractItemModel::headerDataChanged,
+            this, &LineGraphView::scheduleRedraw);
+  }
+  scheduleRedraw();
+}
+
+/*
+ * Method: addOverlay
+ */
+void LineGraphView::addOverlay(DerivedSeries *series)
+{
+  series->setParent(this);
+  overlays.append(series);
+  scheduleRedraw();
+}
+
+/*
+ * Method: addDatasetOverlay
+ */
+void LineGraphView::addDatasetOverlay(const QString &name,
+                                      const CSVDataSet &dataSet)
+{
+  datasetNames.append(name);
+  datasetOverlays.append(dataSet);
+  scheduleRedraw();
+}
+
+/*
+ * Method: clearOverlays
+ */
+void LineGraphView::clearOverlays()
+{
+  qDeleteAll(overlays);
+  overlays.clear();
+  datasetNames.clear();
+  datasetOverlays.clear();
+  scheduleRedraw();
+}
+
 /*
  * Method: visualRect
  */
@@ -82,7 +258,9 @@ bool LineGraphView::eventFilter(QObject *object, QEvent *event)
 {
   if ((object == view) && (event->type() == QEvent::Resize))
   {
+    // The number of pixel columns drawn depends on the view width.
     view->fitInView(sceneRectangle);
+    scheduleRedraw();
     return false;
   }
   else
@@ -161,38 +339,89 @@ bool LineGraphView::isIndexHidden(const QModelIndex &index) const
 /*
  * Method: dataChanged
  */
-void LineGraphView::dataChanged(const QModelIndex &topLeft,
-                                const QModelIndex &bottomRight,
+void LineGraphView::dataChanged(const QModelIndex &/*topLeft*/,
+                                const QModelIndex &/*bottomRight*/,
                                 const QVector<int> &/*roles*/)
 {
-  // Expect only single instances to be modified.
-  // This is consistent with the interface.
-  for (int row = topLeft.row(); row <= bottomRight.row(); row++)
-  {
-    QModelIndex xIndex = model()->index(row, 0);
-    QModelIndex yIndex = model()->index(row, 1);
-    double xVal = model()->data(xIndex).toDouble();
-    double yVal = model()->data(yIndex).toDouble();
-    QPointF newPoint = QPointF(xVal, yVal);
-    indexPointHash.insert(xIndex, newPoint);
-  }
-
   // Recompute path; this is an unfortunate limitation of the QPainterPath.
-  redrawPath();
+  scheduleRedraw();
 }
 
 /*
  * Method: rowsAboutToBeRemoved
  */
-void LineGraphView::rowsAboutToBeRemoved(const QModelIndex &/*parent*/,
+void LineGraphView::rowsAboutToBeRemoved(const QModelIndex &parent,
                                          int start, int end)
 {
-  for (int i = start; i <= end; i++)
-  {
-    QModelIndex index = model()->index(i, 0);
-    indexPointHash.remove(index);
-  }
-  redrawPath();
+  // The deferred redraw runs once the rows are gone.
+  QAbstractItemView::rowsAboutToBeRemoved(parent, start, end);
+  scheduleRedraw();
+}
+
+/*
+ * Method: rowsInserted
+ */
+void LineGraphView::rowsInserted(const QModelIndex &parent, int start,
+                                 int end)
+{
+  QAbstractItemView::rowsInserted(parent, start, end);
+  scheduleRedraw();
+}
+
+/*
+ * Method: reset
+ */
+void LineGraphView::reset()
+{
+  // The filter may have changed which rows are drawn.
+  QAbstractItemView::reset();
+  bucketsValid = false;
+  scheduleRedraw();
+}
+
+/*
+ * Method: dataRowsInserted
+ */
+void LineGraphView::dataRowsInserted(const QModelIndex &parent, int first,
+                                     int)
+{
+  // Rows appended are bucketed at the next redraw; others move those kept.
+  if (!parent.isValid() && (first < bucketedRows - evictedRows))
+    bucketsValid = false;
+}
+
+/*
+ * Method: dataRowsRemoved
+ */
+void LineGraphView::dataRowsRemoved(const QModelIndex &parent, int first,
+                                    int last)
+{
+  int bucketed = bucketedRows - evictedRows;
+  if (parent.isValid() || (first >= bucketed))
+    return;
+
+  // Rows evicted from the front leave the buckets at the next redraw.
+  if ((first == 0) && (last < bucketed))
+    evictedRows += last + 1;
+  else
+    bucketsValid = false;
+}
+
+/*
+ * Method: invalidateBuckets
+ */
+void LineGraphView::invalidateBuckets()
+{
+  bucketsValid = false;
+}
+
+/*
+ * Method: scheduleRedraw
+ */
+void LineGraphView::scheduleRedraw()
+{
+  if (!redrawTimer.isActive())
+    redrawTimer.start();
 }
 
 /*
@@ -200,87 +429,536 @@ void LineGraphView::rowsAboutToBeRemoved(const QModelIndex &/*parent*/,
  */
 void LineGraphView::redrawPath()
 {
-  // Need to recompute entire path; can't just add/modify/remove one object.
-  QPainterPath path;
-  double minX, minY, maxX, maxY;
+  if (!view || !model())
+    return;
 
-  // Sort points; find minimum and maximum x and y.
-  QMap<double,double> points;
-  QHash<QModelIndex,QPointF>::const_iterator i = indexPointHash.constBegin();
-  minX = maxX = i.value().x();
-  minY = maxY = i.value().y();
+  // The data path comes from the buckets kept; the rest is redrawn.
+  QString xLabelText, yLabelText;
+  bool drawn = buildScene(scene, view->viewport()->width(), 0,
+                          &xLabelText, &yLabelText, true);
+  xLabel->setText(xLabelText);
+  yLabel->setText(yLabelText);
+  view->setScene(scene);
+  if (!drawn)
+    return;
 
-  while (i != indexPointHash.constEnd())
+  // Finally draw scene.
+  sceneRectangle = scene->sceneRect();
+  view->fitInView(sceneRectangle);
+  view->show();
+}
+
+/*
+ * Method: exportGraph
+ */
+void LineGraphView::exportGraph(const QString &fName, int dpi)
+    throw(CSVFileException)
+{
+  std::string msg = "Unable to export graph to \"" + fName.toStdString() +
+      "\".";
+  if (!view || !model() || (dpi <= 0))
+    throw CSVFileException(msg);
+
+  // The graph keeps its size on screen, in inches, at the new resolution.
+  QWidget *viewport = view->viewport();
+  QSize size(qMax(1, viewport->width() * dpi / viewport->logicalDpiX()),
+             qMax(1, viewport->height() * dpi / viewport->logicalDpiY()));
+  QRect target(QPoint(0, 0), size);
+
+  // Lines as wide, in inches, as they are on screen.
+  qreal penWidth = qreal(dpi) / viewport->logicalDpiX();
+
+  QString suffix = QFileInfo(fName).suffix().toLower();
+  if (suffix == "png")
+  {
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.setDotsPerMeterX(qRound(dpi / 0.0254));
+    image.setDotsPerMeterY(qRound(dpi / 0.0254));
+    image.fill(Qt::white);
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    renderGraph(&painter, target, penWidth);
+    painter.end();
+    if (!image.save(fName, "PNG"))
+      throw CSVFileException(msg);
+  }
+  else if (suffix == "svg")
   {
-    double x = i.value().x();
-    double y = i.value().y();
+    QSvgGenerator generator;
+    generator.setFileName(fName);
+    generator.setSize(size);
+    generator.setViewBox(target);
+    generator.setResolution(dpi);
+    generator.setTitle(model()->headerData(1, Qt::Horizontal).toString());
+
+    QPainter painter;
+    if (!painter.begin(&generator))
+      throw CSVFileException(msg);
+    renderGraph(&painter, target, penWidth);
+    if (!painter.end())
+      throw CSVFileException(msg);
+  }
+  else if (suffix == "pdf")
+  {
+    QPdfWriter writer(fName);
+    writer.setResolution(dpi);
+    writer.setPageSize(QPageSize(QSizeF(size) / dpi, QPageSize::Inch));
+    writer.setPageMargins(QMarginsF(0, 0, 0, 0));
+
+    QPainter painter;
+    if (!painter.begin(&writer))
+      throw CSVFileException(msg);
+    renderGraph(&painter, target, penWidth);
+    if (!painter.end())
+      throw CSVFileException(msg);
+  }
+  else
+  {
+    throw CSVFileException("Unable to export graph to \"" +
+                           fName.toStdString() +
+                           "\": use a .png, .svg or .pdf file.");
+  }
+}
+
+/*
+ * Method: renderGraph
+ */
+void LineGraphView::renderGraph(QPainter *painter, const QRect &target,
+                                qreal penWidth)
+{
+  // Labels share a line below the graph, as they do on screen.
+  QFontMetrics metrics = painter->fontMetrics();
+  int textHeight = metrics.height();
+  QRect plot(target.left(), target.top(), target.width(),
+             qMax(1, target.height() - textHeight));
+
+  // A scene of its own, decimated to the columns of the target.
+  QGraphicsScene exportScene;
+  QString xLabelText, yLabelText;
+  bool drawn = buildScene(&exportScene, plot.width(), penWidth,
+                          &xLabelText, &yLabelText, false);
+
+  if (drawn)
+  {
+    // The scene's Y axis points up.
+    painter->save();
+    painter->translate(0, plot.top() + plot.bottom());
+    painter->scale(1, -1);
+    exportScene.render(painter, plot, exportScene.sceneRect(),
+                       Qt::IgnoreAspectRatio);
+    painter->restore();
+  }
 
-    if (x < minX)
-      minX = x;
-    if (x > maxX)
-      maxX = x;
+  int half = target.width() / 2;
+  QRect xText(target.left(), plot.bottom(), half, textHeight);
+  QRect yText(target.left() + half, plot.bottom(), target.width() - half,
+              textHeight);
+  painter->setPen(Qt::black);
+  painter->drawText(xText, Qt::AlignLeft | Qt::AlignVCenter,
+                    metrics.elidedText(xLabelText, Qt::ElideRight, half));
+  painter->drawText(yText, Qt::AlignLeft | Qt::AlignVCenter,
+                    metrics.elidedText(yLabelText, Qt::ElideRight,
+                                       yText.width()));
+}
 
-    if (y < minY)
-      minY = y;
-    if (y > maxY)
-      maxY = y;
+/*
+ * Method: buildScene
+ */
+bool LineGraphView::buildScene(QGraphicsScene *target, int columns,
+                               qreal penWidth, QString *xLabelText,
+                               QString *yLabelText, bool incremental)
+{
+  target->clear();
+  QString xName = model()->headerData(0, Qt::Horizontal).toString();
+  QString yName = model()->headerData(1, Qt::Horizontal).toString();
+
+  // Find minimum and maximum x and y from the buckets kept, when they hold
+  //   every row, or else from the block statistics.
+  double minX = NAN, minY = NAN, maxX = NAN, maxY = NAN;
+  bool bucketed = dataModel && incremental && updateBuckets(columns);
+  if (bucketed && (!filterModel ||
+                   (filterModel->rowCount() == dataModel->rowCount())))
+  {
+    bucketBounds(dataBuckets, &minX, &maxX, &minY, &maxY);
+  }
+  else if (dataModel)
+  {
+    minX = dataModel->xColumn().minimum();
+    maxX = dataModel->xColumn().maximum();
+    minY = dataModel->yColumn().minimum();
+    maxY = dataModel->yColumn().maximum();
+  }
 
-    points.insert(x, y);
-    i++;
+  // Overlays are computed here, only once they are to be drawn.
+  for (int i = 0; dataModel && (i < overlays.size()); i++)
+  {
+    DerivedSeries *series = overlays.at(i);
+    series->update();
+    if ((series->minimum() < minY) || (minY != minY))
+      minY = series->minimum();
+    if ((series->maximum() > maxY) || (maxY != maxY))
+      maxY = series->maximum();
   }
 
-  //Add points to path in order.
-  QMap<double,double>::const_iterator j = points.constBegin();
-  path.moveTo(QPointF(j.key(), j.value()));
+  // Other data sets widen both axes.
+  for (int i = 0; i < datasetOverlays.size(); i++)
+  {
+    const CSVDataSet &dataSet = datasetOverlays.at(i);
+    if ((dataSet.xData.minimum() < minX) || (minX != minX))
+      minX = dataSet.xData.minimum();
+    if ((dataSet.xData.maximum() > maxX) || (maxX != maxX))
+      maxX = dataSet.xData.maximum();
+    if ((dataSet.yData.minimum() < minY) || (minY != minY))
+      minY = dataSet.yData.minimum();
+    if ((dataSet.yData.maximum() > maxY) || (maxY != maxY))
+      maxY = dataSet.yData.maximum();
+  }
 
-  while (j != points.constEnd())
+  if (!dataModel || (minX != minX) || (minY != minY))
   {
-    path.lineTo(QPointF(j.key(), j.value()));
-    j++;
+    // Nothing to draw.
+    *xLabelText = "X: " + xName;
+    *yLabelText = "Y: " + yName;
+    return false;
   }
 
+  QPainterPath path;
+  if (bucketed)
+    path = bucketPath(dataBuckets);
+  else
+    path = decimate(dataModel->xColumn(), dataModel->yColumn(), minX, maxX,
+                    columns, filterModel);
+
   // Set scene properties; draw connected line.
-  sceneRectangle = QRectF(minX, minY, (maxX - minX),
-                          (maxY - minY));
-  scene->clear();
-  scene->setSceneRect(sceneRectangle);
+  target->setSceneRect(QRectF(minX, minY, (maxX - minX), (maxY - minY)));
 
   QPen pen = QPen(Qt::SolidLine);
   pen.setCapStyle(Qt::RoundCap);
   pen.setJoinStyle(Qt::MiterJoin);
-  pen.setWidthF(0);
+  pen.setWidthF(penWidth);
+  pen.setCosmetic(true);
   pen.setColor(QColor(255, 0, 0));
-  scene->addPath(path, pen);
+  target->addPath(path, pen);
+
+  // Overlays, cycling through a few distinct colours.
+  static const QColor overlayColors[] = {
+    QColor(0, 0, 255), QColor(0, 128, 0), QColor(192, 0, 192),
+    QColor(255, 128, 0)
+  };
+  QString overlayNames;
+  for (int i = 0; i < overlays.size(); i++)
+  {
+    const DerivedSeries *series = overlays.at(i);
+    QPainterPath overlayPath;
+    if (series->isRowAligned())
+      overlayPath = decimate(dataModel->xColumn(), *series, minX, maxX,
+                             columns);
+    else
+      overlayPath = decimate(series->resampledX(), series->resampledY(),
+                             minX, maxX, columns);
+    pen.setColor(overlayColors[i % 4]);
+    target->addPath(overlayPath, pen);
+    overlayNames += ", " + series->name();
+  }
+  for (int i = 0; i < datasetOverlays.size(); i++)
+  {
+    const CSVDataSet &dataSet = datasetOverlays.at(i);
+    QPainterPath overlayPath = decimate(dataSet.xData, dataSet.yData,
+                                        minX, maxX, columns);
+    pen.setColor(overlayColors[(overlays.size() + i) % 4]);
+    target->addPath(overlayPath, pen);
+    overlayNames += ", " + datasetNames.at(i);
+  }
 
   // Draw axes.
   pen.setColor(QColor(0, 0, 0));
-  scene->addLine(minX, 0, maxX, 0, pen);
-  scene->addLine(0, minY, 0, maxY, pen);
+  target->addLine(minX, 0, maxX, 0, pen);
+  target->addLine(0, minY, 0, maxY, pen);
 
-  // X axis labels.
+  // X axis labels.  Ticks are counted, not stepped to the maximum: a step
+  //   below the resolution of timestamp X values would never advance.
   double stepH = (maxX - minX) / 10.0;
   double stepV = (maxY - minY) / 10.0;
-  for (double pos = minX; pos < maxX; pos += stepH)
+  for (int i = 0; i < 10; i++)
   {
-    scene->addLine(pos, stepV / -10.0,
-                   pos, stepV / 10.0, pen);
+    double pos = minX + i * stepH;
+    target->addLine(pos, stepV / -10.0,
+                    pos, stepV / 10.0, pen);
+  }
+  *xLabelText = "X: " + xName + " (" + QString::number(stepH) + ")";
+  if (dataModel->xTimeFormat() != TimestampParser::None)
+  {
+    // Time axis: step as a duration, anchored at the first timestamp.
+    *xLabelText = "X: " + xName + " (" +
+        TimestampParser::durationText(stepH) + " from " +
+        TimestampParser::toText(minX) + ")";
   }
-  QString xLabelText = "X: " + model()->headerData(0,Qt::Horizontal).toString() +
-      " (" + QString::number(stepH) + ")";
-  xLabel->setText(xLabelText);
 
   // Y axis labels.
-  for (double pos = minY; pos < maxY; pos += stepV)
+  for (int i = 0; i < 10; i++)
   {
-    scene->addLine(stepH / -10.0, pos,
-                   stepH / 10.0, pos, pen);
+    double pos = minY + i * stepV;
+    target->addLine(stepH / -10.0, pos,
+                    stepH / 10.0, pos, pen);
   }
-  QString yLabelText = "Y: " + model()->headerData(1,Qt::Horizontal).toString() +
-      " (" + QString::number(stepV) + ")";
-  yLabel->setText(yLabelText);
+  *yLabelText = "Y: " + yName + overlayNames + " (" +
+      QString::number(stepV) + ")";
+  return true;
+}
 
-  // Finally draw scene.
-  view->setScene(scene);
-  view->fitInView(sceneRectangle);
-  view->show();
+/*
+ * Method: updateBuckets
+ */
+bool LineGraphView::updateBuckets(int columns)
+{
+  columns = qMax(columns, 1);
+  if (bucketsValid && (columns == bucketColumns) && shiftBuckets() &&
+      (dataBuckets.size() <= 2 * columns) &&
+      (2 * dataBuckets.size() >= columns))
+    return true;
+
+  // Bucket every row afresh, over the X range of the data alone.
+  const DataColumn &xColumn = dataModel->xColumn();
+  double minX = xColumn.minimum();
+  double maxX = xColumn.maximum();
+  bucketsValid = false;
+  if ((minX != minX) || (maxX != maxX))
+    return false;
+
+  PixelBucket empty;
+  empty.used = false;
+  dataBuckets = QVector<PixelBucket>(columns, empty);
+  bucketColumns = columns;
+  bucketMinX = minX;
+  bucketScale = (maxX > minX) ? (columns / (maxX - minX)) : 0.0;
+  bucketOffset = 0;
+  bucketize(xColumn, dataModel->yColumn(), minX, bucketScale, dataBuckets,
+            filterModel);
+
+  bucketLastX = maxX;
+  bucketsAscending = xColumn.isAscending();
+  bucketedRows = xColumn.size();
+  evictedRows = 0;
+  bucketsValid = true;
+  return true;
+}
+
+/*
+ * Method: shiftBuckets
+ */
+bool LineGraphView::shiftBuckets()
+{
+  const DataColumn &xColumn = dataModel->xColumn();
+  if (evictedRows > 0)
+  {
+    // With ascending X, evicted rows filled the leading buckets alone.
+    bucketedRows -= evictedRows;
+    evictedRows = 0;
+    if (!bucketsAscending || (bucketedRows <= 0) || (bucketScale <= 0.0))
+      return false;
+
+    double firstX;
+    xColumn.read(0, 1, &firstX);
+    double position = bucketPosition(firstX);
+    if (!(position >= 0) || (position >= dataBuckets.size()))
+      return false;
+
+    // The bucket now first may have lost rows; gather those left in it.
+    dataBuckets.remove(0, int(position));
+    bucketOffset += qint64(position);
+    dataBuckets[0].used = false;
+    addRows(0, bucketedRows, true);
+  }
+
+  int rows = xColumn.size();
+  if (bucketedRows < rows)
+  {
+    if (!addRows(bucketedRows, rows, false))
+      return false;
+    bucketedRows = rows;
+  }
+  return true;
+}
+
+/*
+ * Method: addRows
+ */
+bool LineGraphView::addRows(int first, int end, bool leading)
+{
+  const DataColumn &xColumn = dataModel->xColumn();
+  const DataColumn &yColumn = dataModel->yColumn();
+  PixelBucket empty;
+  empty.used = false;
+
+  QVector<double> xs(DataColumn::BlockSize), ys(DataColumn::BlockSize);
+  for (int start = first; start < end; start += xs.size())
+  {
+    int count = qMin(xs.size(), end - start);
+    xColumn.read(start, count, xs.data());
+    yColumn.read(start, count, ys.data());
+
+    for (int i = 0; i < count; i++)
+    {
+      double x = xs.at(i), y = ys.at(i);
+      if (!std::isfinite(x) || !std::isfinite(y) ||
+          (filterModel && !filterModel->isAccepted(start + i)))
+        continue;
+
+      double position = bucketPosition(x);
+      if (leading)
+      {
+        // Rows past the first bucket are already in those following.
+        if (position > 0)
+          return true;
+        addPoint(dataBuckets[0], x, y);
+        continue;
+      }
+
+      // Rows out of order, or far past the graph, call for a rebuild.
+      if ((x < bucketLastX) || !(position >= 0) ||
+          (position >= 2 * bucketColumns))
+        return false;
+      while (dataBuckets.size() <= position)
+        dataBuckets.append(empty);
+      addPoint(dataBuckets[int(position)], x, y);
+      bucketLastX = x;
+    }
+  }
+  return true;
+}
+
+/*
+ * Method: bucketPosition
+ */
+double LineGraphView::bucketPosition(double x) const
+{
+  return std::floor((x - bucketMinX) * bucketScale) - double(bucketOffset);
+}
+
+/*
+ * Method: decimate
+ */
+template <class YColumn>
+QPainterPath LineGraphView::decimate(const DataColumn &xColumn,
+                                     const YColumn &yColumn,
+                                     double minX, double maxX, int columns,
+                                     const RowFilterProxyModel *filter)
+{
+  columns = qMax(columns, 1);
+  PixelBucket empty;
+  empty.used = false;
+  QVector<PixelBucket> buckets(columns, empty);
+  double scale = (maxX > minX) ? (columns / (maxX - minX)) : 0.0;
+  bucketize(xColumn, yColumn, minX, scale, buckets, filter);
+  return bucketPath(buckets);
+}
+
+/*
+ * Method: bucketize
+ */
+template <class YColumn>
+void LineGraphView::bucketize(const DataColumn &xColumn,
+                              const YColumn &yColumn, double minX,
+                              double scale, QVector<PixelBucket> &buckets,
+                              const RowFilterProxyModel *filter)
+{
+  int columns = buckets.size();
+  QVector<double> xScratch(DataColumn::MaxBlockSize);
+  QVector<double> yScratch(DataColumn::MaxBlockSize);
+
+  for (int b = 0; b < xColumn.blockCount(); b++)
+  {
+    int start = xColumn.blockStart(b);
+    int length = xColumn.blockLength(b);
+    bool aligned = (b < yColumn.blockCount()) &&
+        (yColumn.blockStart(b) == start) && (yColumn.blockLength(b) == length);
+    const DataColumn::BlockStats &xStats = xColumn.blockStats(b);
+
+    // Skip blocks filtered out entirely; test rows of those partly so.
+    bool partial = false;
+    if (filter)
+    {
+      int accepted = filter->acceptedBefore(start + length) -
+          filter->acceptedBefore(start);
+      if (accepted == 0)
+        continue;
+      partial = (accepted < length);
+    }
+
+    // A block of ascending X within one pixel column needs only its summary.
+    if (!partial && aligned && xStats.ascending && xStats.finite &&
+        yColumn.blockStats(b).finite)
+    {
+      int first = qBound(0, int((xStats.first - minX) * scale), columns - 1);
+      int last = qBound(0, int((xStats.last - minX) * scale), columns - 1);
+      if (first == last)
+      {
+        const DataColumn::BlockStats &yStats = yColumn.blockStats(b);
+        double middle = (xStats.first + xStats.last) / 2.0;
+        addPoint(buckets[first], xStats.first, yStats.first);
+        addPoint(buckets[first], middle, yStats.minimum);
+        addPoint(buckets[first], middle, yStats.maximum);
+        addPoint(buckets[first], xStats.last, yStats.last);
+        continue;
+      }
+    }
+
+    const double *xs = xColumn.blockData(b, xScratch.data());
+    const double *ys = yScratch.constData();
+    if (aligned)
+      ys = yColumn.blockData(b, yScratch.data());
+    else
+      yColumn.read(start, length, yScratch.data());
+
+    for (int i = 0; i < length; i++)
+    {
+      double x = xs[i], y = ys[i];
+      if (!std::isfinite(x) || !std::isfinite(y) ||
+          (partial && !filter->isAccepted(start + i)))
+        continue;
+      int column = qBound(0, int((x - minX) * scale), columns - 1);
+      addPoint(buckets[column], x, y);
+    }
+  }
+}
+
+/*
+ * Method: bucketPath
+ */
+QPainterPath LineGraphView::bucketPath(const QVector<PixelBucket> &buckets)
+{
+  // Add points to path in order.
+  QPainterPath path;
+  bool started = false;
+  for (int i = 0; i < buckets.size(); i++)
+  {
+    const PixelBucket &bucket = buckets.at(i);
+    if (!bucket.used)
+      continue;
+
+    QPointF points[4] = {
+      QPointF(bucket.firstX, bucket.firstY),
+      QPointF(bucket.lowX, bucket.lowY),
+      QPointF(bucket.highX, bucket.highY),
+      QPointF(bucket.lastX, bucket.lastY)
+    };
+    if (bucket.highX < bucket.lowX)
+      qSwap(points[1], points[2]);
+
+    for (int j = 0; j < 4; j++)
+    {
+      if (!started)
+      {
+        path.moveTo(points[j]);
+        started = true;
+      }
+      else
+      {
+        path.lineTo(points[j]);
+      }
+    }
+  }
+
+  return path;
 }
@@ -13,12 +13,33 @@
 
 /* Qt includes. */
 #include <QAbstractItemView>
+#include <QList>
 #include <QGraphicsView>
 #include <QGraphicsScene>
 #include <QLabel>
+#include <QPainter>
+#include <QPainterPath>
+#include <QTimer>
 
 #include <QEvent>
 
+/* Project includes. */
+#include "CSVDataModel.h"
+#include "CSVFileException.h"
+#include "DerivedSeries.h"
+#include "RowFilterProxyModel.h"
+
+/*
+ * Struct: PixelBucket
+ * Description: Extreme points of the data falling in one pixel column.
+ */
+struct PixelBucket
+{
+  bool used;
+  double firstX, firstY, lastX, lastY;
+  double lowX, lowY, highX, highY;
+};
+
 /*
  * Class: LineGraphView
  * Description: Provides a line-graph view into associated data model.
@@ -61,6 +82,59 @@ class LineGraphView : public QAbstractItemView
      */
     void setLabels(QLabel *xLabel, QLabel *yLabel);
 
+    /*
+     * Method: setModel
+     * Description: Associates the model to draw.  Column data is read in
+     *            : bulk when the model is a CSVDataModel, or a
+     *            : RowFilterProxyModel over one, whose accepted rows alone
+     *            : are drawn.
+     * Parameters: model: Model to draw.
+     * Returns: none.
+     */
+    void setModel(QAbstractItemModel *model);
+
+    /*
+     * Method: addOverlay
+     * Description: Draws a derived series over the data, in its own colour;
+     *            : the view takes ownership of the series.
+     * Parameters: series: Series to draw.
+     * Returns: none.
+     */
+    void addOverlay(DerivedSeries *series);
+
+    /*
+     * Method: addDatasetOverlay
+     * Description: Draws another data set over the data, in its own colour;
+     *            : the axes widen to include it.
+     * Parameters: name: Name shown in the Y label.
+     *           : dataSet: Data to draw; its columns are shared, not copied.
+     * Returns: none.
+     */
+    void addDatasetOverlay(const QString &name, const CSVDataSet &dataSet);
+
+    /*
+     * Method: clearOverlays
+     * Description: Removes and destroys all derived series and data set
+     *            : overlays.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void clearOverlays();
+
+    /*
+     * Method: exportGraph
+     * Description: Renders the graph, overlays, axes and axis labels
+     *            : offscreen to a PNG image, SVG drawing or PDF document,
+     *            : chosen by the file's suffix.  The graph keeps its size on
+     *            : screen, in inches, and is decimated to the pixel columns
+     *            : of the chosen resolution, so vector files stay small
+     *            : however many rows are drawn.
+     * Parameters: fName: Name of file to write.
+     *           : dpi: Resolution in dots per inch.
+     * Returns: none.
+     */
+    void exportGraph(const QString &fName, int dpi) throw(CSVFileException);
+
     /*
      * Method: visualRect
      * Description: Determines rectangle on screen which item occupies.
@@ -185,10 +259,60 @@ class LineGraphView : public QAbstractItemView
      *           : start, end: Beginning and ending row indices.
      * Returns: none.
      */
-    //void rowsInserted(const QModelIndex &parent, int start, int end);
+    void rowsInserted(const QModelIndex &parent, int start, int end);
+
+    /*
+     * Method: reset
+     * Description: Called when the model is reset; redraws line graph.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void reset();
+
+  /* Private slots. */
+  private slots:
+    /*
+     * Method: dataRowsInserted
+     * Description: Keeps the data buckets if rows were appended, to be
+     *            : bucketed at the next redraw; discards them otherwise.
+     * Parameters: parent: Parent index.
+     *           : first, last: Range of rows inserted.
+     * Returns: none.
+     */
+    void dataRowsInserted(const QModelIndex &parent, int first, int last);
+
+    /*
+     * Method: dataRowsRemoved
+     * Description: Counts rows evicted from the front, to be dropped from
+     *            : the data buckets at the next redraw; discards the
+     *            : buckets if bucketed rows were removed elsewhere.
+     * Parameters: parent: Parent index.
+     *           : first, last: Range of rows removed.
+     * Returns: none.
+     */
+    void dataRowsRemoved(const QModelIndex &parent, int first, int last);
+
+    /*
+     * Method: invalidateBuckets
+     * Description: Discards the data buckets, to be rebuilt at the next
+     *            : redraw.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void invalidateBuckets();
 
   /* Private members. */
   private:
+    /*
+     * Method: scheduleRedraw
+     * Description: Requests a redraw at the next display frame, so that a
+     *            : burst of model changes, such as rows streamed in live,
+     *            : redraws once per frame at most.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void scheduleRedraw();
+
     /*
      * Method: redrawPath
      * Description: Recomputes and redraws the graphics line path.
@@ -197,14 +321,153 @@ class LineGraphView : public QAbstractItemView
      */
     void redrawPath();
 
+    /*
+     * Method: buildScene
+     * Description: Draws the data, overlays and axes into a scene, in data
+     *            : coordinates, and composes the axis label texts.
+     * Parameters: target: Scene to draw into; cleared first.
+     *           : columns: Number of pixel columns to decimate to.
+     *           : penWidth: Line width in device pixels; 0 for hairlines.
+     *           : xLabelText, yLabelText: Receive the axis label texts.
+     *           : incremental: True to draw the data from the buckets kept
+     *           :            : between redraws; false to decimate afresh.
+     * Returns: True if anything was drawn; false if there is no data.
+     */
+    bool buildScene(QGraphicsScene *target, int columns, qreal penWidth,
+                    QString *xLabelText, QString *yLabelText,
+                    bool incremental);
+
+    /*
+     * Method: renderGraph
+     * Description: Paints the graph with its axis labels below it, drawn
+     *            : from a scene of its own decimated to the target width.
+     * Parameters: painter: Painter on the export device.
+     *           : target: Rectangle to fill, in device pixels.
+     *           : penWidth: Line width in device pixels.
+     * Returns: none.
+     */
+    void renderGraph(QPainter *painter, const QRect &target, qreal penWidth);
+
+    /*
+     * Method: decimate
+     * Description: Builds a line path with at most four vertices per pixel
+     *            : column: the first, last, lowest and highest point in
+     *            : each.  Blocks of ascending X lying within one pixel
+     *            : column are summarised from their statistics without
+     *            : being decoded.
+     * Parameters: xColumn, yColumn: Data to draw; yColumn may be any type
+     *           :                  : with DataColumn's block accessors.
+     *           : minX, maxX: Horizontal extent of the graph.
+     *           : columns: Number of pixel columns.
+     *           : filter: Filter whose accepted rows are drawn; 0 for all.
+     * Returns: Decimated path in data coordinates.
+     */
+    template <class YColumn>
+    static QPainterPath decimate(const DataColumn &xColumn,
+                                 const YColumn &yColumn,
+                                 double minX, double maxX, int columns,
+                                 const RowFilterProxyModel *filter = 0);
+
+    /*
+     * Method: bucketize
+     * Description: Accumulates the points of the data into pixel buckets;
+     *            : points beyond either end fall in the end buckets.
+     * Parameters: xColumn, yColumn: Data to bucket, as for decimate.
+     *           : minX: X at the left edge of the first bucket.
+     *           : scale: Buckets per unit of X.
+     *           : buckets: Buckets to accumulate into.
+     *           : filter: Filter whose accepted rows are bucketed; 0 for all.
+     * Returns: none.
+     */
+    template <class YColumn>
+    static void bucketize(const DataColumn &xColumn, const YColumn &yColumn,
+                          double minX, double scale,
+                          QVector<PixelBucket> &buckets,
+                          const RowFilterProxyModel *filter);
+
+    /*
+     * Method: bucketPath
+     * Description: Builds a line path through the points of pixel buckets.
+     * Parameters: buckets: Buckets, in order of X.
+     * Returns: Path in data coordinates.
+     */
+    static QPainterPath bucketPath(const QVector<PixelBucket> &buckets);
+
+    /*
+     * Method: updateBuckets
+     * Description: Brings the data buckets kept for the screen up to date.
+     *            : Rows appended in ascending X are added to the end
+     *            : buckets, and rows evicted from the front drop the
+     *            : leading buckets, with the one left first re-bucketed;
+     *            : other changes, or a span of buckets far from the
+     *            : columns, rebucket every row.
+     * Parameters: columns: Number of pixel columns on screen.
+     * Returns: True if the buckets hold the data; false if there is none.
+     */
+    bool updateBuckets(int columns);
+
+    /*
+     * Method: shiftBuckets
+     * Description: Applies rows evicted and appended since the last redraw
+     *            : to the data buckets.
+     * Parameters: none.
+     * Returns: True if applied; false if the buckets must be rebuilt.
+     */
+    bool shiftBuckets();
+
+    /*
+     * Method: addRows
+     * Description: Adds a range of rows to the data buckets.
+     * Parameters: first, end: Range of rows, end exclusive.
+     *           : leading: True to add only the rows of the first bucket,
+     *           :        : stopping at the first row past it.
+     * Returns: True if added; false if a row falls before the last one
+     *        : added or far past the end, so the buckets must be rebuilt.
+     */
+    bool addRows(int first, int end, bool leading);
+
+    /*
+     * Method: bucketPosition
+     * Description: Finds the data bucket an X value falls in.
+     * Parameters: x: X value.
+     * Returns: Index of the bucket, which may be out of range.
+     */
+    double bucketPosition(double x) const;
+
     QRectF sceneRectangle;
     QGraphicsView *view;
     QGraphicsScene *scene;
 
     QLabel *xLabel, *yLabel;
 
-    // Map of model indices to graphics objects.
-    QHash<QModelIndex,QPointF> indexPointHash;
+    // Model providing column data; 0 if the model is not a CSVDataModel.
+    CSVDataModel *dataModel;
+
+    // Filter between the view and dataModel; 0 if none.
+    RowFilterProxyModel *filterModel;
+
+    // Coalesces redraw requests into one per display frame.
+    QTimer redrawTimer;
+
+    // Derived series, and other data sets, drawn over the data.
+    QList<DerivedSeries*> overlays;
+    QList<QString> datasetNames;
+    QList<CSVDataSet> datasetOverlays;
+
+    // Data decimated for the screen, kept between redraws.  Bucket i spans
+    //   X from bucketMinX + (bucketOffset + i) / bucketScale.
+    QVector<PixelBucket> dataBuckets;
+    bool bucketsValid;
+    int bucketColumns;
+    double bucketMinX, bucketScale;
+    qint64 bucketOffset;
+
+    // Last X added, and whether every bucketed X ascends.
+    double bucketLastX;
+    bool bucketsAscending;
+
+    // Leading rows of the model bucketed, including those since evicted.
+    int bucketedRows, evictedRows;
 };
 
 #endif // LINEGRAPHVIEW_H
@@ -0,0 +1,19 @@
+#-------------------------------------------------
+#
+# Reference client streaming rows to CSVGrapher's live ingest socket.
+#
+#-------------------------------------------------
+
+QT       += core network
+QT       -= gui
+
+TARGET = LiveIngestClient
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+INCLUDEPATH += ..
+
+SOURCES += main.cpp
+
+HEADERS  += ../LiveIngestProtocol.h
@@ -0,0 +1,196 @@
+/*
+ * main.cpp: Reference live ingest client; streams a generated signal to a
+ *         : running CSVGrapher at a fixed row rate.
+ * Author: B. D. Knopp: bdknopp@users.noreply.github.com
+ * Version: 1.00: Initial implementation.
+ * Date: 19 October 2026
+ */
+
+/* C includes. */
+#include <cmath>
+#include <cstring>
+
+/* Qt includes. */
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QLocalSocket>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+#include <QtEndian>
+
+/* Project includes. */
+#include "LiveIngestProtocol.h"
+
+// Rows sent per frame, at most.
+static const int FrameRows = 16384;
+
+// Bytes queued on the socket before waiting for CSVGrapher to read them.
+static const qint64 MaxQueued = 1 << 22;
+
+/*
+ * Procedure: appendHeader
+ * Description: Appends a frame header to a frame under construction.
+ * Parameters: frame: Frame to append to.
+ *           : type: Frame type.
+ *           : length: Payload length in bytes.
+ * Returns: none.
+ */
+static void appendHeader(QByteArray &frame, quint32 type, quint32 length)
+{
+  uchar header[LiveIngest::HeaderSize];
+  qToLittleEndian<quint32>(type, header);
+  qToLittleEndian<quint32>(length, header + 4);
+  frame.append(reinterpret_cast<const char *>(header), LiveIngest::HeaderSize);
+}
+
+/*
+ * Procedure: binaryFrame
+ * Description: Encodes rows as a binary frame.
+ * Parameters: xs, ys: Values of each row.
+ *           : rows: Number of rows.
+ * Returns: Frame, header included.
+ */
+static QByteArray binaryFrame(const double *xs, const double *ys, int rows)
+{
+  const int RowBytes = 2 * sizeof(double);
+  QByteArray frame;
+  frame.reserve(LiveIngest::HeaderSize + rows * RowBytes);
+  appendHeader(frame, LiveIngest::BinaryFrame, rows * RowBytes);
+
+  int offset = frame.size();
+  frame.resize(offset + rows * RowBytes);
+  uchar *row = reinterpret_cast<uchar *>(frame.data() + offset);
+  for (int i = 0; i < rows; i++, row += RowBytes)
+  {
+    quint64 x, y;
+    memcpy(&x, xs + i, sizeof(double));
+    memcpy(&y, ys + i, sizeof(double));
+    qToLittleEndian<quint64>(x, row);
+    qToLittleEndian<quint64>(y, row + sizeof(double));
+  }
+  return frame;
+}
+
+/*
+ * Procedure: textFrame
+ * Description: Encodes rows as a CSV text frame.
+ * Parameters: xs, ys: Values of each row.
+ *           : rows: Number of rows.
+ * Returns: Frame, header included.
+ */
+static QByteArray textFrame(const double *xs, const double *ys, int rows)
+{
+  QByteArray text;
+  for (int i = 0; i < rows; i++)
+  {
+    text += QByteArray::number(xs[i], 'g', 17);
+    text += ',';
+    text += QByteArray::number(ys[i], 'g', 17);
+    text += '\n';
+  }
+
+  QByteArray frame;
+  appendHeader(frame, LiveIngest::TextFrame, text.size());
+  frame += text;
+  return frame;
+}
+
+/*
+ * Procedure: main
+ * Description: Connects to CSVGrapher and streams rows until disconnected,
+ *            : reporting the rate achieved each second.
+ * Parameters: argc: Argument count.
+ *           : argv: Argument vector: [--rate rows/s] [--text]
+ *           :     : [--server name].
+ * Returns: 0 once disconnected; 1 on a usage or connection error.
+ */
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+
+  double rate = 1000000.0;
+  bool text = false;
+  QString name = LiveIngest::DefaultServerName;
+  QStringList arguments = app.arguments();
+  bool valid = true;
+  for (int i = 1; valid && (i < arguments.size()); i++)
+  {
+    const QString &argument = arguments.at(i);
+    if (argument == "--text")
+      text = true;
+    else if ((argument == "--rate") && (i + 1 < arguments.size()))
+      rate = arguments.at(++i).toDouble(&valid);
+    else if ((argument == "--server") && (i + 1 < arguments.size()))
+      name = arguments.at(++i);
+    else
+      valid = false;
+  }
+  if (!valid || !(rate > 0.0))
+  {
+    err << "Usage: LiveIngestClient [--rate rows/s] [--text] "
+           "[--server name]\n";
+    return 1;
+  }
+
+  QLocalSocket socket;
+  socket.connectToServer(name);
+  if (!socket.waitForConnected(5000))
+  {
+    err << "Unable to connect to \"" << name << "\": "
+        << socket.errorString() << "\n";
+    return 1;
+  }
+
+  // X is seconds since the epoch; Y a sine wave with a faster ripple.
+  const double Pi = 3.14159265358979323846;
+  QVector<double> xs(FrameRows), ys(FrameRows);
+  double start = QDateTime::currentMSecsSinceEpoch() / 1000.0;
+  QElapsedTimer clock;
+  clock.start();
+  qint64 sent = 0, reportedRows = 0, reportedTime = 0;
+
+  while (socket.state() == QLocalSocket::ConnectedState)
+  {
+    qint64 due = qint64(clock.nsecsElapsed() * 1e-9 * rate);
+    int rows = int(qMin<qint64>(due - sent, FrameRows));
+    if (rows <= 0)
+    {
+      QThread::usleep(500);
+      continue;
+    }
+
+    for (int i = 0; i < rows; i++)
+    {
+      double t = (sent + i) / rate;
+      xs[i] = start + t;
+      ys[i] = std::sin(2.0 * Pi * t) + 0.1 * std::sin(2.0 * Pi * 97.0 * t);
+    }
+    socket.write(text ? textFrame(xs.constData(), ys.constData(), rows)
+                      : binaryFrame(xs.constData(), ys.constData(), rows));
+    sent += rows;
+
+    // Block while CSVGrapher is behind, so memory stays bounded here too.
+    if (socket.bytesToWrite() > MaxQueued)
+      socket.waitForBytesWritten(1000);
+    else
+      socket.flush();
+
+    qint64 now = clock.elapsed();
+    if (now - reportedTime >= 1000)
+    {
+      out << (sent - reportedRows) * 1000 / (now - reportedTime)
+          << " rows/s\n";
+      out.flush();
+      reportedRows = sent;
+      reportedTime = now;
+    }
+  }
+
+  err << "Disconnected: " << socket.errorString() << "\n";
+  return 0;
+}
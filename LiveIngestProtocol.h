@@ -0,0 +1,38 @@
+/*
+ * LiveIngestProtocol.h: Frame layout of the live ingest socket, shared by
+ *                     : CSVGrapher and its clients.
+ * Author: B. D. Knopp: bdknopp@users.noreply.github.com
+ * Version: 1.00: Initial implementation.
+ * Date: 19 October 2026
+ */
+
+#ifndef LIVEINGESTPROTOCOL_H
+#define LIVEINGESTPROTOCOL_H
+
+/* Qt includes. */
+#include <QtGlobal>
+
+/*
+ * Namespace: LiveIngest
+ * Description: A client streams frames over a local socket.  Each frame is
+ *            : an 8-byte header, a little-endian 32-bit frame type then a
+ *            : little-endian 32-bit payload length, followed by the payload:
+ *            :   BinaryFrame: rows of two little-endian IEEE doubles, X then
+ *            :              : Y; the length must be a multiple of 16.
+ *            :   TextFrame: CSV rows "x,y", separated by newlines; an empty
+ *            :            : cell is stored as an empty cell.
+ *            : A malformed frame closes the connection.
+ */
+namespace LiveIngest
+{
+  enum FrameType { BinaryFrame = 1, TextFrame = 2 };
+
+  // Size of a frame header, and largest payload accepted.
+  const int HeaderSize = 8;
+  const quint32 MaxPayload = 1 << 24;
+
+  // Name of the socket CSVGrapher listens on.
+  const char *const DefaultServerName = "CSVGrapher";
+}
+
+#endif // LIVEINGESTPROTOCOL_H
@@ -0,0 +1,286 @@
+/*
+ * LiveIngestServer.cpp: See "LiveIngestServer.h" for documentation.
+ */
+
+#include "LiveIngestServer.h"
+
+/* C includes. */
+#include <cmath>
+#include <cstring>
+
+/* Qt includes. */
+#include <QGuiApplication>
+#include <QScreen>
+#include <QtEndian>
+
+/*
+ * Constructor: LiveIngestServer
+ */
+LiveIngestServer::LiveIngestServer(CSVDataModel *model, QObject *parent) :
+  QObject(parent),
+  model(model)
+{
+  connect(&server, &QLocalServer::newConnection,
+          this, &LiveIngestServer::acceptClients);
+
+  // Append at most once per display frame.
+  QScreen *screen = QGuiApplication::primaryScreen();
+  qreal rate = screen ? screen->refreshRate() : 60.0;
+  flushTimer.setSingleShot(true);
+  flushTimer.setInterval(qMax(1, int(1000.0 / qMax(rate, qreal(1.0)))));
+  connect(&flushTimer, &QTimer::timeout, this, &LiveIngestServer::flush);
+}
+
+/*
+ * Destructor: ~LiveIngestServer
+ */
+LiveIngestServer::~LiveIngestServer()
+{
+  // Rows still pending are dropped; the model may already be gone.
+  flushTimer.stop();
+  server.close();
+}
+
+/*
+ * Method: listen
+ */
+bool LiveIngestServer::listen(const QString &name)
+{
+  if (server.isListening())
+    close();
+
+  QLocalServer::removeServer(name);
+  return server.listen(name);
+}
+
+/*
+ * Method: close
+ */
+void LiveIngestServer::close()
+{
+  flush();
+
+  QList<QLocalSocket *> sockets = buffers.keys();
+  buffers.clear();
+  for (int i = 0; i < sockets.size(); i++)
+  {
+    QLocalSocket *socket = sockets.at(i);
+    disconnect(socket, 0, this, 0);
+    socket->abort();
+    socket->deleteLater();
+  }
+  server.close();
+}
+
+/*
+ * Method: acceptClients
+ */
+void LiveIngestServer::acceptClients()
+{
+  while (server.hasPendingConnections())
+  {
+    QLocalSocket *socket = server.nextPendingConnection();
+    socket->setReadBufferSize(ReadBufferSize);
+    buffers.insert(socket, QByteArray());
+    connect(socket, &QLocalSocket::readyRead,
+            this, &LiveIngestServer::readClient);
+    connect(socket, &QLocalSocket::disconnected,
+            this, &LiveIngestServer::removeClient);
+  }
+}
+
+/*
+ * Method: readClient
+ */
+void LiveIngestServer::readClient()
+{
+  QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+  if (!socket || !buffers.contains(socket))
+    return;
+
+  QByteArray &buffer = buffers[socket];
+  buffer.append(socket->readAll());
+
+  QString reason;
+  if (!decodeFrames(buffer, &reason))
+  {
+    buffers.remove(socket);
+    disconnect(socket, 0, this, 0);
+    socket->abort();
+    socket->deleteLater();
+    emit clientRejected(reason);
+  }
+
+  if (pendingX.size() >= MaxPendingRows)
+    flush();
+  else if (!pendingX.isEmpty() && !flushTimer.isActive())
+    flushTimer.start();
+}
+
+/*
+ * Method: removeClient
+ */
+void LiveIngestServer::removeClient()
+{
+  QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+  if (!socket)
+    return;
+
+  buffers.remove(socket);
+  socket->deleteLater();
+}
+
+/*
+ * Method: flush
+ */
+void LiveIngestServer::flush()
+{
+  flushTimer.stop();
+  int count = pendingX.size();
+  if (count == 0)
+    return;
+
+  model->appendRows(pendingX.constData(), pendingY.constData(), count);
+
+  // Keep the capacity for the next frame's rows.
+  pendingX.resize(0);
+  pendingY.resize(0);
+  emit rowsIngested(count);
+}
+
+/*
+ * Method: decodeFrames
+ */
+bool LiveIngestServer::decodeFrames(QByteArray &buffer, QString *reason)
+{
+  int offset = 0;
+  while (buffer.size() - offset >= LiveIngest::HeaderSize)
+  {
+    const uchar *header =
+        reinterpret_cast<const uchar *>(buffer.constData() + offset);
+    quint32 type = qFromLittleEndian<quint32>(header);
+    quint32 length = qFromLittleEndian<quint32>(header + 4);
+    if (length > LiveIngest::MaxPayload)
+    {
+      *reason = tr("Frame of %1 bytes exceeds the limit.").arg(length);
+      return false;
+    }
+    if (buffer.size() - offset - LiveIngest::HeaderSize < int(length))
+      break;
+
+    const char *begin = buffer.constData() + offset + LiveIngest::HeaderSize;
+    const char *end = begin + length;
+    switch (type)
+    {
+      case LiveIngest::BinaryFrame:
+        if (!decodeBinary(begin, end))
+        {
+          *reason = tr("Binary frame of %1 bytes is not whole rows.")
+              .arg(length);
+          return false;
+        }
+        break;
+      case LiveIngest::TextFrame:
+        if (!decodeText(begin, end))
+        {
+          *reason = tr("Text frame holds an invalid row.");
+          return false;
+        }
+        break;
+      default:
+        *reason = tr("Unknown frame type %1.").arg(type);
+        return false;
+    }
+    offset += LiveIngest::HeaderSize + int(length);
+  }
+
+  buffer.remove(0, offset);
+  return true;
+}
+
+/*
+ * Method: decodeBinary
+ */
+bool LiveIngestServer::decodeBinary(const char *begin, const char *end)
+{
+  const int RowBytes = 2 * sizeof(double);
+  if ((end - begin) % RowBytes != 0)
+    return false;
+
+  int rows = int((end - begin) / RowBytes);
+  int first = pendingX.size();
+  pendingX.resize(first + rows);
+  pendingY.resize(first + rows);
+  double *xs = pendingX.data() + first;
+  double *ys = pendingY.data() + first;
+
+  const uchar *row = reinterpret_cast<const uchar *>(begin);
+  for (int i = 0; i < rows; i++, row += RowBytes)
+  {
+    quint64 x = qFromLittleEndian<quint64>(row);
+    quint64 y = qFromLittleEndian<quint64>(row + sizeof(double));
+    memcpy(xs + i, &x, sizeof(double));
+    memcpy(ys + i, &y, sizeof(double));
+  }
+  return true;
+}
+
+/*
+ * Method: decodeText
+ */
+bool LiveIngestServer::decodeText(const char *begin, const char *end)
+{
+  int first = pendingX.size();
+  const char *line = begin;
+  while (line < end)
+  {
+    const char *lineEnd =
+        static_cast<const char *>(memchr(line, '\n', end - line));
+    if (!lineEnd)
+      lineEnd = end;
+
+    const char *rowEnd = lineEnd;
+    if ((rowEnd > line) && (rowEnd[-1] == '\r'))
+      rowEnd--;
+
+    if (rowEnd > line)
+    {
+      const char *comma =
+          static_cast<const char *>(memchr(line, ',', rowEnd - line));
+      double x, y;
+      if (!comma || !decodeCell(line, comma, 0, &x) ||
+          !decodeCell(comma + 1, rowEnd, 1, &y))
+      {
+        // Drop the frame's rows along with the frame.
+        pendingX.resize(first);
+        pendingY.resize(first);
+        return false;
+      }
+      pendingX.append(x);
+      pendingY.append(y);
+    }
+    line = lineEnd + 1;
+  }
+  return true;
+}
+
+/*
+ * Method: decodeCell
+ */
+bool LiveIngestServer::decodeCell(const char *begin, const char *end,
+                                  int column, double *value) const
+{
+  while ((begin < end) && ((*begin == ' ') || (*begin == '\t')))
+    begin++;
+  while ((end > begin) && ((end[-1] == ' ') || (end[-1] == '\t')))
+    end--;
+  if (begin == end)
+  {
+    *value = NAN;
+    return true;
+  }
+
+  TimestampParser::Format format =
+      (column == 0) ? model->xTimeFormat() : TimestampParser::None;
+  return TimestampParser::parse(format, begin, end, value);
+}
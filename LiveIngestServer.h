@@ -0,0 +1,170 @@
+/*
+ * LiveIngestServer.h: Local socket endpoint appending rows streamed by other
+ *                   : processes to a CSVDataModel.
+ * Author: B. D. Knopp: bdknopp@users.noreply.github.com
+ * Version: 1.00: Initial implementation.
+ * Date: 19 October 2026
+ */
+
+#ifndef LIVEINGESTSERVER_H
+#define LIVEINGESTSERVER_H
+
+/* Qt includes. */
+#include <QObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QHash>
+#include <QByteArray>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+/* Project includes. */
+#include "CSVDataModel.h"
+#include "LiveIngestProtocol.h"
+
+/*
+ * Class: LiveIngestServer
+ * Description: Accepts any number of local clients sending the frames
+ *            : described in "LiveIngestProtocol.h".  Decoded rows are
+ *            : gathered and appended to the model at most once per display
+ *            : frame, so views see a few large appends rather than one per
+ *            : frame received.  Each socket's read buffer is bounded, so a
+ *            : producer faster than the GUI is held back by the socket
+ *            : instead of growing memory.
+ */
+class LiveIngestServer : public QObject
+{
+  Q_OBJECT
+
+  /* Public types. */
+  public:
+    // Bytes buffered per client before reading from it pauses.
+    static const int ReadBufferSize = 1 << 22;
+
+    // Rows gathered before appending without waiting for the next frame.
+    static const int MaxPendingRows = 1 << 18;
+
+    // Rows kept by the model while ingesting, by default.
+    static const int DefaultRetention = 10000000;
+
+  /* Public methods. */
+  public:
+    /*
+     * Constructor: LiveIngestServer
+     * Description: Creates a server feeding a model; does not listen.
+     * Parameters: model: Model to append rows to.
+     *           : parent: Parent object to associate with; default 0.
+     */
+    explicit LiveIngestServer(CSVDataModel *model, QObject *parent = 0);
+
+    /*
+     * Destructor: ~LiveIngestServer
+     * Description: Disconnects all clients and stops listening.
+     */
+    ~LiveIngestServer();
+
+    /*
+     * Method: listen
+     * Description: Starts accepting clients, removing a stale socket of the
+     *            : same name left by a crashed instance.
+     * Parameters: name: Local socket name.
+     * Returns: True if listening; false otherwise, see errorString().
+     */
+    bool listen(const QString &name);
+
+    /*
+     * Method: close
+     * Description: Appends any rows received, disconnects all clients and
+     *            : stops listening.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void close();
+
+    /*
+     * Methods: isListening, serverName, errorString
+     * Description: Retrieve the state of the socket server.
+     * Parameters: none.
+     * Returns: Whether listening; socket name; last error.
+     */
+    bool isListening() const { return server.isListening(); }
+    QString serverName() const { return server.serverName(); }
+    QString errorString() const { return server.errorString(); }
+
+  /* Signals. */
+  signals:
+    /*
+     * Signal: rowsIngested
+     * Description: Emitted after rows are appended to the model.
+     * Parameters: count: Number of rows appended.
+     */
+    void rowsIngested(int count);
+
+    /*
+     * Signal: clientRejected
+     * Description: Emitted when a client is disconnected for sending a
+     *            : malformed frame.
+     * Parameters: reason: Description of the fault.
+     */
+    void clientRejected(const QString &reason);
+
+  /* Private slots. */
+  private slots:
+    /*
+     * Methods: acceptClients, readClient, removeClient, flush
+     * Description: Accept pending connections; decode the frames a client
+     *            : has sent; forget a disconnected client; append gathered
+     *            : rows to the model.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void acceptClients();
+    void readClient();
+    void removeClient();
+    void flush();
+
+  /* Private members. */
+  private:
+    /*
+     * Method: decodeFrames
+     * Description: Decodes the complete frames at the front of a buffer.
+     * Parameters: buffer: Bytes received; complete frames are removed.
+     *           : reason: Receives the fault if a frame is malformed.
+     * Returns: True if all frames were valid; false otherwise.
+     */
+    bool decodeFrames(QByteArray &buffer, QString *reason);
+
+    /*
+     * Methods: decodeBinary, decodeText
+     * Description: Decode a frame payload into the pending rows.
+     * Parameters: begin, end: Payload.
+     * Returns: True if valid; false otherwise.
+     */
+    bool decodeBinary(const char *begin, const char *end);
+    bool decodeText(const char *begin, const char *end);
+
+    /*
+     * Method: decodeCell
+     * Description: Converts one text cell; X cells of timestamp columns
+     *            : are read in the column's format.
+     * Parameters: begin, end: Cell text, which may be empty.
+     *           : column: Column of the cell.
+     *           : value: Receives the value; NaN if empty.
+     * Returns: True if valid; false otherwise.
+     */
+    bool decodeCell(const char *begin, const char *end, int column,
+                    double *value) const;
+
+    CSVDataModel *model;
+    QLocalServer server;
+
+    // Partial frames received from each client.
+    QHash<QLocalSocket *, QByteArray> buffers;
+
+    // Rows decoded but not yet appended, and the timer appending them.
+    QVector<double> pendingX, pendingY;
+    QTimer flushTimer;
+};
+
+#endif // LIVEINGESTSERVER_H
@@ -5,16 +5,45 @@
 #include "MainWindow.h"
 #include "ui_MainWindow.h"
 
+// Characters of text gathered before each write when saving.
+static const int SaveChunkSize = 1024 * 1024;
+
 /*
  * Constructor: MainWindow
  */
 MainWindow::MainWindow(QWidget *parent) :
   QMainWindow(parent),
   ui(new Ui::MainWindow),
-  dataModel(new QStandardItemModel(this))
+  dataModel(new CSVDataModel(this)),
+  filterModel(new RowFilterProxyModel(this)),
+  ingestServer(new LiveIngestServer(dataModel, this)),
+  undoStack(new QUndoStack(this)),
+  currentDataset(-1)
 {
   ui->setupUi(this);
-  initializeModel("X-data", "Y-data", QStringList());
+
+  // Row additions and deletions are undoable until the rows shift otherwise.
+  QAction *undoAction = undoStack->createUndoAction(this, tr("Undo"));
+  QAction *redoAction = undoStack->createRedoAction(this, tr("Redo"));
+  undoAction->setShortcuts(QKeySequence::Undo);
+  redoAction->setShortcuts(QKeySequence::Redo);
+  ui->mainToolBar->addAction(undoAction);
+  ui->mainToolBar->addAction(redoAction);
+  connect(dataModel, &QAbstractItemModel::layoutChanged,
+          undoStack, &QUndoStack::clear);
+  connect(ingestServer, &LiveIngestServer::rowsIngested,
+          undoStack, &QUndoStack::clear);
+
+  connect(ingestServer, &LiveIngestServer::rowsIngested,
+          this, &MainWindow::showStorageStatus);
+  connect(ingestServer, &LiveIngestServer::clientRejected,
+          this, &MainWindow::ingestClientRejected);
+  connect(&pendingFile, &QFutureWatcher<CSVDataSet>::finished,
+          this, &MainWindow::pendingFileParsed);
+  CSVDataSet emptySet;
+  emptySet.xLabel = "X-data";
+  emptySet.yLabel = "Y-data";
+  initializeModel(emptySet);
   initializeViews();
 }
 
@@ -23,11 +52,24 @@ MainWindow::MainWindow(QWidget *parent) :
  */
 MainWindow::~MainWindow()
 {
+  delete ingestServer;
   delete ui;
   delete dataModel;
   delete graphView;
 }
 
+/*
+ * Method: openPendingFile
+ */
+void MainWindow::openPendingFile(const QString &fName,
+                                 const QFuture<CSVDataSet> &dataSet)
+{
+  ui->fileTextBox->setText(fName);
+  ui->statusBar->showMessage(tr("Reading %1...").arg(fName));
+  pendingFileName = fName;
+  pendingFile.setFuture(dataSet);
+}
+
 /*
  * Method: on_browseButton_clicked
  * Description: Browses for a file to open or save.
@@ -37,7 +79,9 @@ MainWindow::~MainWindow()
 void MainWindow::on_browseButton_clicked()
 {
   QString fName = QFileDialog::getOpenFileName(this, tr("Select file..."),
-                                               "~/", tr("CSV File (*.csv)"));
+                                               "~/",
+                                               tr("CSV File (*.csv *.csv.gz "
+                                                  "*.csv.zst)"));
   ui->fileTextBox->setText(fName);
 }
 
@@ -77,18 +121,65 @@ void MainWindow::on_fileSaveButton_clicked()
   }
 }
 
+/*
+ * Method: pendingFileParsed
+ */
+void MainWindow::pendingFileParsed()
+{
+  // Rethrows an exception raised by the parse.
+  try
+  {
+    showDataset(datasets.add(pendingFileName, pendingFile.result(),
+                             CSVParser::FillNaN));
+  }
+  catch (CSVFileException csvFExc)
+  {
+    showStorageStatus();
+    QErrorMessage error;
+    error.showMessage(csvFExc.what());
+    error.exec();
+  }
+  catch (std::exception &exc)
+  {
+    // Other failures, such as running out of memory, reach here wrapped
+    //   as QUnhandledException.
+    showStorageStatus();
+    QErrorMessage error;
+    error.showMessage(tr("Unable to read file \"%1\": %2")
+                      .arg(pendingFileName).arg(exc.what()));
+    error.exec();
+  }
+
+  // Release the watcher's copy of the data.
+  disconnect(&pendingFile, 0, this, 0);
+  pendingFile.setFuture(QFuture<CSVDataSet>());
+}
+
 /*
  * Method: on_addRowButton_clicked
  */
 void MainWindow::on_addRowButton_clicked()
 {
-  // Add single row below currently selected one.
-  //   Or, add at beginning.
-  QModelIndexList rowList = selectionModel->selectedRows();
-  if (rowList.size() > 0)
-    dataModel->insertRows(rowList.at(0).row(), 1);
-  else
-    dataModel->insertRows(0, 1);
+  // Add a single row above each run of selected rows.
+  //   Or, add one at beginning.
+  QVector<DataColumn::RowRange> ranges =
+      CSVDataModel::rowRanges(selectedSourceRows());
+  if (ranges.isEmpty())
+  {
+    DataColumn::RowRange range;
+    range.row = 0;
+    ranges.append(range);
+  }
+
+  // Runs of the command are where the new rows end up.
+  for (int i = 0; i < ranges.size(); i++)
+  {
+    ranges[i].row += i;
+    ranges[i].count = 1;
+  }
+  undoStack->push(new RowRangeCommand(dataModel, RowRangeCommand::Insert,
+                                      ranges));
+  showStorageStatus();
 }
 
 /*
@@ -96,10 +187,280 @@ void MainWindow::on_addRowButton_clicked()
  */
 void MainWindow::on_deleteRowButton_clicked()
 {
-  // Get list of selected rows; delete each one.
-  QModelIndexList rowList = selectionModel->selectedRows();
-  if (rowList.size() > 0)
-    dataModel->removeRows(rowList.at(0).row(), rowList.size());
+  // Get list of selected rows; delete all runs of them as one step.
+  QVector<DataColumn::RowRange> ranges =
+      CSVDataModel::rowRanges(selectedSourceRows());
+  if (ranges.isEmpty())
+    return;
+
+  QElapsedTimer timer;
+  timer.start();
+  undoStack->push(new RowRangeCommand(dataModel, RowRangeCommand::Remove,
+                                      ranges));
+  showStorageStatus();
+  ui->statusBar->showMessage(ui->statusBar->currentMessage() +
+                             tr("; deleted in %1 ms").arg(timer.elapsed()));
+}
+
+/*
+ * Method: on_actionCompactStorage_toggled
+ */
+void MainWindow::on_actionCompactStorage_toggled(bool checked)
+{
+  dataModel->setCompactStorage(checked);
+  showStorageStatus();
+}
+
+/*
+ * Method: on_actionLiveIngest_toggled
+ */
+void MainWindow::on_actionLiveIngest_toggled(bool checked)
+{
+  // Eviction and appends shift rows under the undo steps.
+  undoStack->clear();
+  if (!checked)
+  {
+    ingestServer->close();
+    dataModel->setRetention(0);
+    showStorageStatus();
+    return;
+  }
+
+  dataModel->setRetention(LiveIngestServer::DefaultRetention);
+  if (!ingestServer->listen(LiveIngest::DefaultServerName))
+  {
+    QErrorMessage error;
+    error.showMessage(tr("Unable to accept live data: %1")
+                      .arg(ingestServer->errorString()));
+    error.exec();
+    ui->actionLiveIngest->setChecked(false);
+    return;
+  }
+  ui->statusBar->showMessage(tr("Accepting live data on \"%1\"")
+                             .arg(ingestServer->serverName()));
+}
+
+/*
+ * Method: ingestClientRejected
+ */
+void MainWindow::ingestClientRejected(const QString &reason)
+{
+  ui->statusBar->showMessage(tr("Live data client disconnected: %1")
+                             .arg(reason));
+}
+
+/*
+ * Method: on_actionExportGraph_triggered
+ */
+void MainWindow::on_actionExportGraph_triggered()
+{
+  QString fName = QFileDialog::getSaveFileName(this, tr("Export graph..."),
+                                               "~/",
+                                               tr("PNG Image (*.png);;"
+                                                  "SVG Drawing (*.svg);;"
+                                                  "PDF Document (*.pdf)"));
+  if (fName.isEmpty())
+    return;
+
+  bool accepted = false;
+  int dpi = QInputDialog::getInt(this, tr("Export graph"),
+                                 tr("Resolution (dots per inch):"), 300,
+                                 72, 1200, 1, &accepted);
+  if (!accepted)
+    return;
+
+  // Try to export; display error if failed.
+  QElapsedTimer timer;
+  timer.start();
+  try
+  {
+    graphView->exportGraph(fName, dpi);
+  }
+  catch (CSVFileException csvFExc)
+  {
+    QErrorMessage error;
+    error.showMessage(csvFExc.what());
+    error.exec();
+    return;
+  }
+  ui->statusBar->showMessage(tr("Exported graph to %1 in %2 ms")
+                             .arg(fName).arg(timer.elapsed()));
+}
+
+/*
+ * Method: on_addOverlayButton_clicked
+ */
+void MainWindow::on_addOverlayButton_clicked()
+{
+  // Combo box entries follow the order of DerivedSeries::Kind.
+  DerivedSeries::Kind kind =
+      DerivedSeries::Kind(ui->overlayComboBox->currentIndex());
+  double parameter = ui->overlayParameterSpinBox->value();
+  graphView->addOverlay(new DerivedSeries(dataModel, kind, parameter));
+}
+
+/*
+ * Method: on_clearOverlaysButton_clicked
+ */
+void MainWindow::on_clearOverlaysButton_clicked()
+{
+  graphView->clearOverlays();
+  for (int i = 0; i < overlaidDatasets.size(); i++)
+    datasets.unpin(overlaidDatasets.at(i));
+  overlaidDatasets.clear();
+  showStorageStatus();
+}
+
+/*
+ * Method: on_datasetComboBox_activated
+ */
+void MainWindow::on_datasetComboBox_activated(int index)
+{
+  // Try to show; display error if its data could not be reloaded.
+  try
+  {
+    showDataset(ui->datasetComboBox->itemData(index).toInt());
+  }
+  catch (CSVFileException csvFExc)
+  {
+    ui->datasetComboBox->setCurrentIndex(
+        ui->datasetComboBox->findData(currentDataset));
+    QErrorMessage error;
+    error.showMessage(csvFExc.what());
+    error.exec();
+  }
+}
+
+/*
+ * Method: on_overlayDatasetButton_clicked
+ */
+void MainWindow::on_overlayDatasetButton_clicked()
+{
+  if (currentDataset < 0)
+    return;
+
+  // Overlay the data as currently edited; the overlay shares its columns.
+  CSVDataSet dataSet = dataModel->dataSet();
+  if (dataModel->isModified())
+    datasets.store(currentDataset, dataSet);
+  datasets.pin(currentDataset);
+  overlaidDatasets.append(currentDataset);
+  graphView->addDatasetOverlay(ui->datasetComboBox->currentText(), dataSet);
+}
+
+/*
+ * Method: on_closeDatasetButton_clicked
+ */
+void MainWindow::on_closeDatasetButton_clicked()
+{
+  if (currentDataset < 0)
+    return;
+
+  // Overlays keep drawing the columns they share.
+  int index = ui->datasetComboBox->findData(currentDataset);
+  datasets.close(currentDataset);
+  overlaidDatasets.removeAll(currentDataset);
+  ui->datasetComboBox->removeItem(index);
+  currentDataset = -1;
+
+  // Show the data set listed next, or none.
+  CSVDataSet emptySet;
+  if (ui->datasetComboBox->count() == 0)
+  {
+    initializeModel(emptySet);
+    return;
+  }
+  index = qMin(index, ui->datasetComboBox->count() - 1);
+  try
+  {
+    showDataset(ui->datasetComboBox->itemData(index).toInt());
+  }
+  catch (CSVFileException csvFExc)
+  {
+    ui->datasetComboBox->setCurrentIndex(-1);
+    initializeModel(emptySet);
+    QErrorMessage error;
+    error.showMessage(csvFExc.what());
+    error.exec();
+  }
+}
+
+/*
+ * Method: on_cacheBudgetSpinBox_valueChanged
+ */
+void MainWindow::on_cacheBudgetSpinBox_valueChanged(int megabytes)
+{
+  datasets.setBudget(qint64(megabytes) << 20);
+  showStorageStatus();
+}
+
+/*
+ * Method: on_applyFilterButton_clicked
+ */
+void MainWindow::on_applyFilterButton_clicked()
+{
+  RowFilter filter;
+  filter.xRange = ui->filterXCheckBox->isChecked();
+  filter.yAbove = ui->filterYAboveCheckBox->isChecked();
+  filter.yBelow = ui->filterYBelowCheckBox->isChecked();
+  filter.emptyCells =
+      RowFilter::EmptyCells(ui->filterEmptyComboBox->currentIndex());
+
+  bool valid =
+      (!filter.xRange ||
+       (parseFilterValue(ui->filterXMinimumEdit->text(), 0,
+                         &filter.xMinimum) &&
+        parseFilterValue(ui->filterXMaximumEdit->text(), 0,
+                         &filter.xMaximum))) &&
+      (!filter.yAbove ||
+       parseFilterValue(ui->filterYAboveEdit->text(), 1, &filter.yMinimum)) &&
+      (!filter.yBelow ||
+       parseFilterValue(ui->filterYBelowEdit->text(), 1, &filter.yMaximum));
+  if (!valid)
+  {
+    QErrorMessage error;
+    error.showMessage(tr("Filter bounds must be numbers."));
+    error.exec();
+    return;
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+  filterModel->setFilter(filter);
+  ui->statusBar->showMessage(tr("%1 of %2 rows shown; filtered in %3 ms")
+                             .arg(filterModel->rowCount())
+                             .arg(dataModel->rowCount())
+                             .arg(timer.elapsed()));
+}
+
+/*
+ * Method: on_clearFilterButton_clicked
+ */
+void MainWindow::on_clearFilterButton_clicked()
+{
+  filterModel->setFilter(RowFilter());
+  showStorageStatus();
+}
+
+/*
+ * Method: on_parseErrorList_itemActivated
+ */
+void MainWindow::on_parseErrorList_itemActivated(QListWidgetItem *item)
+{
+  // Rows shift with edits; stay within those there are.
+  int row = qMin(item->data(Qt::UserRole).toInt(), dataModel->rowCount() - 1);
+  if (row < 0)
+    return;
+
+  QModelIndex index = filterModel->mapFromSource(dataModel->index(row, 0));
+  if (!index.isValid())
+  {
+    ui->statusBar->showMessage(tr("Row %1 is filtered out").arg(row + 1));
+    return;
+  }
+  ui->tableView->scrollTo(index, QAbstractItemView::PositionAtCenter);
+  ui->tableView->setCurrentIndex(index);
+  ui->tableView->selectRow(index.row());
 }
 
 /*
@@ -107,45 +468,51 @@ void MainWindow::on_deleteRowButton_clicked()
  */
 void MainWindow::readCSVFile(QString fName) throw(CSVFileException)
 {
-  QFile inFile(fName);
-  if (inFile.open(QIODevice::ReadOnly | QIODevice::Text))
-  {
-    QTextStream inStream(&inFile);
-    QString xLabel, yLabel;
-    QStringList lines;
+  // A file opened by hand supersedes one still parsing from startup; its
+  //   result is freed as soon as its parse ends.
+  disconnect(&pendingFile, 0, this, 0);
+  pendingFile.setFuture(QFuture<CSVDataSet>());
 
-    // Read header information on first line.
-    if (!inStream.atEnd())
-    {
-      QStringList labels = inStream.readLine().split(",");
-
-      // Error if more or less than two columns.
-      if (labels.size() != 2)
-      {
-        std::string msg = "File \"" + fName.toStdString() +
-            "\" incorrectly formatted.";
-        throw CSVFileException(msg);
-      }
-
-      xLabel = labels.at(0);
-      yLabel = labels.at(1);
-    }
+  // Files already open are shared rather than parsed again.  Parsing
+  //   overlaps reading/decompression, which runs on its own thread.
+  CSVParser::ErrorMode mode =
+      CSVParser::ErrorMode(ui->errorModeComboBox->currentIndex());
+  showDataset(datasets.open(fName, dataModel->compactStorage(), mode));
+}
 
-    // Read in all data lines.
-    while (!inStream.atEnd())
-      lines << inStream.readLine();
+/*
+ * Method: showDataset
+ */
+void MainWindow::showDataset(int id) throw(CSVFileException)
+{
+  // Reload first, so that nothing changes if that fails.
+  CSVDataSet dataSet = datasets.dataSet(id);
 
-    initializeModel(xLabel, yLabel, lines);
+  // Keep the edits made to the data set shown until now.
+  if ((currentDataset >= 0) && (currentDataset != id))
+  {
+    if (dataModel->isModified())
+      datasets.store(currentDataset, dataModel->dataSet());
+    datasets.unpin(currentDataset);
+    datasets.pin(id);
   }
-  else
+  else if (currentDataset < 0)
   {
-    // Couldn't open file; abort with exception.
-    std::string msg = "Cannot open file \"" + fName.toStdString() +
-        "\" for reading.";
-    throw CSVFileException(msg);
+    datasets.pin(id);
   }
+  currentDataset = id;
 
-  inFile.close();
+  // Items carry their data set's identifier; closed ones leave the list.
+  int index = ui->datasetComboBox->findData(id);
+  if (index < 0)
+  {
+    QString fName = datasets.fileName(id);
+    ui->datasetComboBox->addItem(QFileInfo(fName).fileName(), id);
+    index = ui->datasetComboBox->count() - 1;
+    ui->datasetComboBox->setItemData(index, fName, Qt::ToolTipRole);
+  }
+  ui->datasetComboBox->setCurrentIndex(index);
+  initializeModel(dataSet);
 }
 
 /*
@@ -153,56 +520,114 @@ void MainWindow::readCSVFile(QString fName) throw(CSVFileException)
  */
 void MainWindow::writeCSVFile(QString fName) throw(CSVFileException)
 {
-  QFile outFile(fName);
-  if (outFile.open(QFile::WriteOnly | QFile::Truncate |
-                   QFile::Text))
-  {
-    // Write header information on first line.
-    QTextStream outStream(&outFile);
-    QString xLabel = dataModel->headerData(0, Qt::Horizontal).toString();
-    QString yLabel = dataModel->headerData(1, Qt::Horizontal).toString();
-    outStream << xLabel << "," << yLabel << "\n";
+  // Compressed to match the name, so the file opens as it was read.
+  CompressedFileWriter outFile;
+  outFile.open(fName);
+
+  // Write header information on first line.
+  QString xLabel = dataModel->headerData(0, Qt::Horizontal).toString();
+  QString yLabel = dataModel->headerData(1, Qt::Horizontal).toString();
+  QString text = xLabel + "," + yLabel + "\n";
 
-    // Write lines of data.
-    for (int i = 0; i < dataModel->rowCount(); i++)
+  // Write lines of data, a piece at a time.
+  for (int i = 0; i < dataModel->rowCount(); i++)
+  {
+    text += dataModel->fileText(i, 0) + "," + dataModel->fileText(i, 1) +
+        "\n";
+    if (text.size() >= SaveChunkSize)
     {
-      QString xItem = dataModel->data(dataModel->index(i, 0, QModelIndex()),
-                                      Qt::DisplayRole).toString();
-      QString yItem = dataModel->data(dataModel->index(i, 1, QModelIndex()),
-                                      Qt::DisplayRole).toString();
-      outStream << xItem << "," << yItem << "\n";
+      outFile.write(text.toLocal8Bit());
+      text.clear();
     }
   }
-  else
-  {
-    // Couldn't open file; abort with exception.
-    std::string msg = "Cannot open file \"" + fName.toStdString() +
-        "\" for writing.";
-    throw CSVFileException(msg);
-  }
-
+  outFile.write(text.toLocal8Bit());
   outFile.close();
 }
 
 /*
  * Method: initializeModel
  */
-void MainWindow::initializeModel(QString xLabel, QString yLabel,
-                                 QStringList dataLines)
+void MainWindow::initializeModel(const CSVDataSet &dataSet)
+{
+  undoStack->clear();
+  dataModel->setDataSet(dataSet);
+  showStorageStatus();
+  showParseErrors();
+}
+
+/*
+ * Method: showStorageStatus
+ */
+void MainWindow::showStorageStatus()
 {
-  dataModel->setRowCount(dataLines.size());
-  dataModel->setColumnCount(2);
-  dataModel->setHeaderData(0, Qt::Horizontal, xLabel);
-  dataModel->setHeaderData(1, Qt::Horizontal, yLabel);
+  double megabytes = dataModel->memoryUsage() / (1024.0 * 1024.0);
+  QString status = tr("%1 rows; %2 MB").arg(dataModel->rowCount())
+      .arg(megabytes, 0, 'f', 1);
+  if (datasets.openCount() > 0)
+  {
+    double cached = datasets.memoryUsage() / (1024.0 * 1024.0);
+    status += tr("; %1 data sets, %2 MB held").arg(datasets.openCount())
+        .arg(cached, 0, 'f', 1);
+  }
+  ui->statusBar->showMessage(status);
+}
 
-  for (int i = 0; i < dataLines.size(); i++)
+/*
+ * Method: showParseErrors
+ */
+void MainWindow::showParseErrors()
+{
+  const CSVParseLog &log = dataModel->parseLog();
+  ui->parseErrorList->clear();
+  for (int i = 0; i < log.errors.size(); i++)
   {
-    QStringList data = dataLines.at(i).split(",");
-    dataModel->setData(dataModel->index(i, 0, QModelIndex()),
-                       data.at(0).toDouble());
-    dataModel->setData(dataModel->index(i, 1, QModelIndex()),
-                       data.at(1).toDouble());
+    const CSVParseError &error = log.errors.at(i);
+    QListWidgetItem *item = new QListWidgetItem(
+        tr("Line %1 (byte %2): %3").arg(error.line).arg(error.offset)
+        .arg(CSVParser::errorDescription(error.kind)));
+    item->setData(Qt::UserRole, error.row);
+    ui->parseErrorList->addItem(item);
   }
+  if (log.count > log.errors.size())
+  {
+    QListWidgetItem *item = new QListWidgetItem(
+        tr("%1 more not listed").arg(log.count - log.errors.size()));
+    item->setData(Qt::UserRole, -1);
+    ui->parseErrorList->addItem(item);
+  }
+  ui->parseErrorList->setVisible(log.count > 0);
+
+  if (log.count > 0)
+    ui->statusBar->showMessage(ui->statusBar->currentMessage() +
+                               tr("; %1 malformed lines").arg(log.count));
+}
+
+/*
+ * Method: parseFilterValue
+ */
+bool MainWindow::parseFilterValue(const QString &text, int column,
+                                  double *value)
+{
+  QByteArray bytes = text.trimmed().toUtf8();
+  const char *begin = bytes.constData();
+  const char *end = begin + bytes.size();
+  if ((column == 0) && (dataModel->xTimeFormat() != TimestampParser::None) &&
+      TimestampParser::parseIso8601(begin, end, value))
+    return true;
+  return CSVParser::parseNumber(begin, end, value);
+}
+
+/*
+ * Method: selectedSourceRows
+ */
+QList<int> MainWindow::selectedSourceRows() const
+{
+  QModelIndexList rowList = selectionModel->selectedRows();
+  QList<int> rows;
+  for (int i = 0; i < rowList.size(); i++)
+    rows.append(filterModel->mapToSource(rowList.at(i)).row());
+  std::sort(rows.begin(), rows.end());
+  return rows;
 }
 
 /*
@@ -211,12 +636,17 @@ void MainWindow::initializeModel(QString xLabel, QString yLabel,
 void MainWindow::initializeViews()
 {
   // Line graph view.
+  filterModel->setSourceModel(dataModel);
   graphView = new LineGraphView();
-  graphView->setModel(dataModel);
+  graphView->setModel(filterModel);
   graphView->setGraphicsView(ui->graphicsView);
   graphView->setLabels(ui->xLabel, ui->yLabel);
 
-  selectionModel = new QItemSelectionModel(dataModel);
-  ui->tableView->setModel(dataModel);
+  selectionModel = new QItemSelectionModel(filterModel);
+  ui->tableView->setModel(filterModel);
   ui->tableView->setSelectionModel(selectionModel);
+
+  // Sort only when a column header is clicked, not on enabling.
+  ui->tableView->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+  ui->tableView->setSortingEnabled(true);
 }
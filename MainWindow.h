@@ -10,25 +10,40 @@
 #define MAINWINDOW_H
 
 /* C++ includes. */
+#include <algorithm>
 #include <exception>
 
 /* Qt includes. */
 #include <QMainWindow>
 #include <QFileDialog>
 #include <QErrorMessage>
+#include <QInputDialog>
 
 #include <QFile>
+#include <QFileInfo>
 #include <QIODevice>
 #include <QTextStream>
 
-#include <QStandardItemModel>
 #include <QItemSelectionModel>
+#include <QListWidgetItem>
+#include <QUndoStack>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QFutureWatcher>
 
 #include <QGraphicsView>
 
 /* Project includes. */
 #include "CSVFileException.h"
+#include "CSVParser.h"
+#include "CSVDataModel.h"
+#include "CompressedFileWriter.h"
+#include "DatasetCache.h"
+#include "DerivedSeries.h"
 #include "LineGraphView.h"
+#include "LiveIngestServer.h"
+#include "RowFilterProxyModel.h"
+#include "RowRangeCommand.h"
 
 /*
  * Namespace: Ui
@@ -56,6 +71,17 @@ class MainWindow : public QMainWindow
      */
     explicit MainWindow(QWidget *parent = 0);
 
+    /*
+     * Method: openPendingFile
+     * Description: Shows a file being parsed elsewhere as the one opening,
+     *            : and places its data into the model once parsed.
+     * Parameters: fName: Name of the file.
+     *           : dataSet: Parse of the file, possibly still running.
+     * Returns: none.
+     */
+    void openPendingFile(const QString &fName,
+                         const QFuture<CSVDataSet> &dataSet);
+
     /*
      * Destructor: ~MainWindow
      * Description: Destroys instance of MainWindow.
@@ -88,9 +114,19 @@ class MainWindow : public QMainWindow
      */
     void on_fileSaveButton_clicked();
 
+    /*
+     * Method: pendingFileParsed
+     * Description: Places the data of a file passed to openPendingFile into
+     *            : the model, or reports why it could not be read.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void pendingFileParsed();
+
     /*
      * Method: on_addRowButton_clicked
-     * Description: Adds a new row under the currently selected one.
+     * Description: Adds empty rows above each run of selected rows, as many
+     *            : as it holds, or one at the beginning; undoable.
      * Parameters: none.
      * Returns: none.
      */
@@ -98,18 +134,134 @@ class MainWindow : public QMainWindow
 
     /*
      * Method: on_deleteRowButton_clicked
-     * Description: Deletes the currently selected row.
+     * Description: Deletes the selected rows, contiguous or not, as one
+     *            : undoable step.
      * Parameters: none.
      * Returns: none.
      */
     void on_deleteRowButton_clicked();
 
+    /*
+     * Method: on_actionCompactStorage_toggled
+     * Description: Switches the data model between raw and compact column
+     *            : encodings; files opened afterwards are encoded as read.
+     * Parameters: checked: Whether compact storage is selected.
+     * Returns: none.
+     */
+    void on_actionCompactStorage_toggled(bool checked);
+
+    /*
+     * Method: on_actionLiveIngest_toggled
+     * Description: Starts or stops accepting rows streamed over the local
+     *            : socket; while accepting, the model keeps only the most
+     *            : recent rows.
+     * Parameters: checked: Whether live ingest is selected.
+     * Returns: none.
+     */
+    void on_actionLiveIngest_toggled(bool checked);
+
+    /*
+     * Method: ingestClientRejected
+     * Description: Reports a live ingest client disconnected for sending
+     *            : malformed data.
+     * Parameters: reason: Description of the fault.
+     * Returns: none.
+     */
+    void ingestClientRejected(const QString &reason);
+
+    /*
+     * Method: on_actionExportGraph_triggered
+     * Description: Asks for a file and resolution, and exports the graph
+     *            : to it as a PNG image, SVG drawing or PDF document.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void on_actionExportGraph_triggered();
+
+    /*
+     * Method: on_addOverlayButton_clicked
+     * Description: Adds the selected derived series to the graph.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void on_addOverlayButton_clicked();
+
+    /*
+     * Method: on_clearOverlaysButton_clicked
+     * Description: Removes all derived series from the graph.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void on_clearOverlaysButton_clicked();
+
+    /*
+     * Method: on_datasetComboBox_activated
+     * Description: Shows an open data set in the table and graph, keeping
+     *            : the edits made to the one shown before.
+     * Parameters: index: Position of the data set chosen in the list.
+     * Returns: none.
+     */
+    void on_datasetComboBox_activated(int index);
+
+    /*
+     * Method: on_overlayDatasetButton_clicked
+     * Description: Keeps the data set shown drawn in the graph after
+     *            : another is chosen, for comparison.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void on_overlayDatasetButton_clicked();
+
+    /*
+     * Method: on_closeDatasetButton_clicked
+     * Description: Closes the data set shown, discarding its edits, and
+     *            : shows the one listed next, if any.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void on_closeDatasetButton_clicked();
+
+    /*
+     * Method: on_cacheBudgetSpinBox_valueChanged
+     * Description: Sets the memory budget of data sets not shown.
+     * Parameters: megabytes: Budget in megabytes.
+     * Returns: none.
+     */
+    void on_cacheBudgetSpinBox_valueChanged(int megabytes);
+
+    /*
+     * Method: on_applyFilterButton_clicked
+     * Description: Shows only the rows passing the selected predicates, in
+     *            : both the table and the graph.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void on_applyFilterButton_clicked();
+
+    /*
+     * Method: on_clearFilterButton_clicked
+     * Description: Shows all rows again.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void on_clearFilterButton_clicked();
+
+    /*
+     * Method: on_parseErrorList_itemActivated
+     * Description: Scrolls the table to, and selects, the row of a
+     *            : malformed line.
+     * Parameters: item: Entry of the line in the parse error list.
+     * Returns: none.
+     */
+    void on_parseErrorList_itemActivated(QListWidgetItem *item);
+
   /* Private members. */
   private:
     /*
      * Method: readCSVFile
      * Description: Reads the data contained in the named CSV file, placing it
-     *            : into model.
+     *            : into model and among the open data sets.  The file may be
+     *            : gzip or zstd compressed.
      * Parameters: fName: Name of CSV file to read.
      * Returns: none.
      */
@@ -118,22 +270,65 @@ class MainWindow : public QMainWindow
     /*
      * Method: writeCSVFile
      * Description: Writes the data contained in the model to the named CSV
-     *            : file.
+     *            : file, gzip or zstd compressed if the name ends in ".gz"
+     *            : or ".zst".
      * Parameters: fName: Name of CSV file to write to.
      * Returns: none.
      */
     void writeCSVFile(QString fName) throw(CSVFileException);
 
+    /*
+     * Method: showDataset
+     * Description: Places an open data set into the model, listing it
+     *            : among the data sets if new.
+     * Parameters: id: Identifier of the data set in the cache.
+     * Returns: none.
+     */
+    void showDataset(int id) throw(CSVFileException);
+
     /*
      * Method: initializeModel
      * Description: Populates the data model with labels and data.
-     * Parameters: xLabel: X-axis label.
-     *           : yLabel: Y-axis label.
-     *           : dataLines: Lines of data to place in the model.
+     * Parameters: dataSet: Axis labels and data to place in the model.
+     * Returns: none.
+     */
+    void initializeModel(const CSVDataSet &dataSet);
+
+    /*
+     * Method: showStorageStatus
+     * Description: Shows the row count and data memory use in the status bar.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void showStorageStatus();
+
+    /*
+     * Method: showParseErrors
+     * Description: Lists the malformed lines of the data set shown, below
+     *            : the table; hidden if there are none.
+     * Parameters: none.
      * Returns: none.
      */
-    void initializeModel(QString xLabel, QString yLabel,
-                         QStringList dataLines);
+    void showParseErrors();
+
+    /*
+     * Method: parseFilterValue
+     * Description: Converts a filter bound entered by the user; X bounds of
+     *            : timestamp columns may be ISO-8601 text.
+     * Parameters: text: Text entered.
+     *           : column: Column the bound applies to.
+     *           : value: Receives the bound.
+     * Returns: True if the text was valid; false otherwise.
+     */
+    bool parseFilterValue(const QString &text, int column, double *value);
+
+    /*
+     * Method: selectedSourceRows
+     * Description: Maps the rows selected in the table to data model rows.
+     * Parameters: none.
+     * Returns: Selected rows of the data model, in ascending order.
+     */
+    QList<int> selectedSourceRows() const;
 
     /*
      * Method: initializeViews
@@ -146,12 +341,28 @@ class MainWindow : public QMainWindow
     // Reference to main window.
     Ui::MainWindow *ui;
 
-    // Data Model; selection model.
-    QStandardItemModel *dataModel;
+    // Data Model; filter shown by both views; selection model.
+    CSVDataModel *dataModel;
+    RowFilterProxyModel *filterModel;
     QItemSelectionModel *selectionModel;
 
     // Line graph view scene.
     LineGraphView *graphView;
+
+    // Socket server appending streamed rows to dataModel.
+    LiveIngestServer *ingestServer;
+
+    // Row additions and deletions, for undo.
+    QUndoStack *undoStack;
+
+    // Parse of the file named on the command line.
+    QFutureWatcher<CSVDataSet> pendingFile;
+    QString pendingFileName;
+
+    // Open data sets; that shown in the table; those overlaid in the graph.
+    DatasetCache datasets;
+    int currentDataset;
+    QList<int> overlaidDatasets;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,596 @@
+/*
+ * RowFilterProxyModel.cpp: See "RowFilterProxyModel.h" for documentation.
+ */
+
+#include "RowFilterProxyModel.h"
+
+/* C includes. */
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* C++ includes. */
+#include <algorithm>
+
+/* Qt includes. */
+#include <QtAlgorithms>
+#include <QtConcurrent>
+
+/*
+ * Procedure: evaluateGroup
+ * Description: Evaluates a filter over up to 64 rows.
+ * Parameters: filter: Predicates to evaluate.
+ *           : xs, ys: Row values.
+ *           : count: Number of rows; at most 64.
+ * Returns: Bit i set if row i passes.
+ */
+static inline quint64 evaluateGroup(const RowFilter &filter, const double *xs,
+                                    const double *ys, int count)
+{
+  quint64 result = 0;
+  int i = 0;
+
+#ifdef __SSE2__
+  // Comparisons with NaN are false, as the scalar code's are.
+  const __m128d all = _mm_castsi128_pd(_mm_set1_epi32(-1));
+  const __m128d xMinimum = _mm_set1_pd(filter.xMinimum);
+  const __m128d xMaximum = _mm_set1_pd(filter.xMaximum);
+  const __m128d yMinimum = _mm_set1_pd(filter.yMinimum);
+  const __m128d yMaximum = _mm_set1_pd(filter.yMaximum);
+  for (; i + 2 <= count; i += 2)
+  {
+    __m128d x = _mm_loadu_pd(xs + i);
+    __m128d y = _mm_loadu_pd(ys + i);
+    __m128d pass = all;
+    if (filter.xRange)
+      pass = _mm_and_pd(pass, _mm_and_pd(_mm_cmpge_pd(x, xMinimum),
+                                         _mm_cmple_pd(x, xMaximum)));
+    if (filter.yAbove)
+      pass = _mm_and_pd(pass, _mm_cmpgt_pd(y, yMinimum));
+    if (filter.yBelow)
+      pass = _mm_and_pd(pass, _mm_cmplt_pd(y, yMaximum));
+    if (filter.emptyCells == RowFilter::HideEmpty)
+      pass = _mm_and_pd(pass, _mm_cmpord_pd(x, y));
+    else if (filter.emptyCells == RowFilter::OnlyEmpty)
+      pass = _mm_and_pd(pass, _mm_cmpunord_pd(x, y));
+    result |= quint64(_mm_movemask_pd(pass)) << i;
+  }
+#endif
+
+  for (; i < count; i++)
+  {
+    double x = xs[i], y = ys[i];
+    bool pass = (!filter.xRange ||
+                 ((x >= filter.xMinimum) && (x <= filter.xMaximum))) &&
+        (!filter.yAbove || (y > filter.yMinimum)) &&
+        (!filter.yBelow || (y < filter.yMaximum));
+    bool empty = (x != x) || (y != y);
+    if (filter.emptyCells == RowFilter::HideEmpty)
+      pass = pass && !empty;
+    else if (filter.emptyCells == RowFilter::OnlyEmpty)
+      pass = pass && empty;
+    if (pass)
+      result |= quint64(1) << i;
+  }
+  return result;
+}
+
+/*
+ * Procedure: orWord
+ * Description: Sets bits of a bitmap from a word at any bit position.
+ * Parameters: words: Bitmap to update.
+ *           : position: Bit position of the word's lowest bit.
+ *           : word: Bits to set.
+ * Returns: none.
+ */
+static inline void orWord(quint64 *words, int position, quint64 word)
+{
+  int offset = position & 63;
+  words[position >> 6] |= word << offset;
+  if (offset && (word >> (64 - offset)))
+    words[(position >> 6) + 1] |= word >> (64 - offset);
+}
+
+/*
+ * Procedure: wordAt
+ * Description: Reads 64 bits of a bitmap from any bit position.
+ * Parameters: words: Bitmap to read.
+ *           : position: Bit position to read from.
+ * Returns: Bits read; zero beyond the end of the bitmap.
+ */
+static inline quint64 wordAt(const QVector<quint64> &words, int position)
+{
+  int index = position >> 6, offset = position & 63;
+  quint64 result = (index < words.size()) ? (words.at(index) >> offset) : 0;
+  if (offset && (index + 1 < words.size()))
+    result |= words.at(index + 1) << (64 - offset);
+  return result;
+}
+
+/*
+ * Procedure: copyBits
+ * Description: Copies a run of bits into a zeroed region of a bitmap.
+ * Parameters: destination: Bitmap to update.
+ *           : to: Bit position to copy to.
+ *           : source: Bitmap to copy from.
+ *           : from: Bit position to copy from.
+ *           : count: Number of bits.
+ * Returns: none.
+ */
+static void copyBits(quint64 *destination, int to,
+                     const QVector<quint64> &source, int from, int count)
+{
+  for (int i = 0; i < count; i += 64)
+  {
+    quint64 word = wordAt(source, from + i);
+    if (count - i < 64)
+      word &= (quint64(1) << (count - i)) - 1;
+    orWord(destination, to + i, word);
+  }
+}
+
+/*
+ * Constructor: RowFilterProxyModel
+ */
+RowFilterProxyModel::RowFilterProxyModel(QObject *parent) :
+  QAbstractProxyModel(parent),
+  model(0),
+  removing(false)
+{
+}
+
+/*
+ * Method: setSourceModel
+ */
+void RowFilterProxyModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+  beginResetModel();
+  if (model)
+    disconnect(model, 0, this, 0);
+
+  QAbstractProxyModel::setSourceModel(sourceModel);
+  model = qobject_cast<CSVDataModel*>(sourceModel);
+  if (model)
+  {
+    connect(model, &QAbstractItemModel::dataChanged,
+            this, &RowFilterProxyModel::sourceDataChanged);
+    connect(model, &QAbstractItemModel::rowsInserted,
+            this, &RowFilterProxyModel::sourceRowsInserted);
+    connect(model, &QAbstractItemModel::rowsAboutToBeRemoved,
+            this, &RowFilterProxyModel::sourceRowsAboutToBeRemoved);
+    connect(model, &QAbstractItemModel::rowsRemoved,
+            this, &RowFilterProxyModel::sourceRowsRemoved);
+    connect(model, &QAbstractItemModel::modelAboutToBeReset,
+            this, &RowFilterProxyModel::sourceAboutToBeReset);
+    connect(model, &QAbstractItemModel::modelReset,
+            this, &RowFilterProxyModel::sourceReset);
+    connect(model, &QAbstractItemModel::layoutAboutToBeChanged,
+            this, &RowFilterProxyModel::sourceAboutToBeReset);
+    connect(model, &QAbstractItemModel::layoutChanged,
+            this, &RowFilterProxyModel::sourceReset);
+    connect(model, &QAbstractItemModel::headerDataChanged,
+            this, &RowFilterProxyModel::sourceHeaderDataChanged);
+  }
+  evaluateAll();
+  endResetModel();
+}
+
+/*
+ * Method: setFilter
+ */
+void RowFilterProxyModel::setFilter(const RowFilter &filter)
+{
+  beginResetModel();
+  rowFilter = filter;
+  evaluateAll();
+  endResetModel();
+}
+
+/*
+ * Method: acceptedBefore
+ */
+int RowFilterProxyModel::acceptedBefore(int sourceRow) const
+{
+  if (!rowFilter.isActive())
+    return sourceRow;
+
+  int word = sourceRow >> 6, offset = sourceRow & 63;
+  int count = rank.at(word);
+  if (offset)
+    count += qPopulationCount(bits.at(word) & ((quint64(1) << offset) - 1));
+  return count;
+}
+
+/*
+ * Method: mapToSource
+ */
+QModelIndex RowFilterProxyModel::mapToSource(const QModelIndex &proxyIndex)
+    const
+{
+  if (!proxyIndex.isValid() || !model)
+    return QModelIndex();
+
+  int row = proxyIndex.row();
+  if (rowFilter.isActive())
+  {
+    // Last word with fewer accepted rows before it than row; then the
+    // remaining count'th set bit within it.
+    int word = int(std::upper_bound(rank.constBegin(), rank.constEnd() - 1,
+                                    row) - rank.constBegin()) - 1;
+    quint64 remaining = bits.at(word);
+    for (int skip = row - rank.at(word); skip > 0; skip--)
+      remaining &= remaining - 1;
+    row = word * 64 + int(qCountTrailingZeroBits(remaining));
+  }
+  return model->index(row, proxyIndex.column());
+}
+
+/*
+ * Method: mapFromSource
+ */
+QModelIndex RowFilterProxyModel::mapFromSource(const QModelIndex &sourceIndex)
+    const
+{
+  if (!sourceIndex.isValid() || !model || !isAccepted(sourceIndex.row()))
+    return QModelIndex();
+  return index(acceptedBefore(sourceIndex.row()), sourceIndex.column());
+}
+
+/*
+ * Method: index
+ */
+QModelIndex RowFilterProxyModel::index(int row, int column,
+                                       const QModelIndex &parent) const
+{
+  if (parent.isValid() || (row < 0) || (row >= rowCount()) ||
+      (column < 0) || (column >= columnCount()))
+    return QModelIndex();
+  return createIndex(row, column);
+}
+
+/*
+ * Method: parent
+ */
+QModelIndex RowFilterProxyModel::parent(const QModelIndex &) const
+{
+  return QModelIndex();
+}
+
+/*
+ * Method: rowCount
+ */
+int RowFilterProxyModel::rowCount(const QModelIndex &parent) const
+{
+  if (parent.isValid() || !model)
+    return 0;
+  return rowFilter.isActive() ? rank.last() : model->rowCount();
+}
+
+/*
+ * Method: columnCount
+ */
+int RowFilterProxyModel::columnCount(const QModelIndex &parent) const
+{
+  if (parent.isValid() || !model)
+    return 0;
+  return model->columnCount();
+}
+
+/*
+ * Method: sourceDataChanged
+ */
+void RowFilterProxyModel::sourceDataChanged(const QModelIndex &topLeft,
+                                            const QModelIndex &bottomRight)
+{
+  int first = topLeft.row(), last = bottomRight.row();
+  if (rowFilter.isActive())
+  {
+    if (last - first + 1 > RescanRows)
+    {
+      beginResetModel();
+      evaluateAll();
+      endResetModel();
+      return;
+    }
+
+    // Evaluate the edited rows together, before any is shown or hidden.
+    int count = last - first + 1;
+    QVector<double> xs(count), ys(count);
+    model->xColumn().read(first, count, xs.data());
+    model->yColumn().read(first, count, ys.data());
+
+    QVector<quint64> outcome((count + 63) / 64, 0);
+    for (int i = 0; i < count; i += 64)
+      outcome[i >> 6] = evaluateGroup(rowFilter, xs.constData() + i,
+                                      ys.constData() + i, qMin(64, count - i));
+
+    // Coalesce rows whose outcome changed into runs adjacent in the proxy;
+    //   only a row shown throughout separates two.
+    QVector<FlipRun> runs;
+    bool open = false;
+    for (int i = 0; i < count; i++)
+    {
+      bool accepted = (outcome.at(i >> 6) >> (i & 63)) & 1;
+      if (accepted == isAccepted(first + i))
+      {
+        if (accepted)
+          open = false;
+        continue;
+      }
+
+      if (open && (runs.last().accepted == accepted))
+      {
+        runs.last().last = first + i;
+        runs.last().count++;
+      }
+      else
+      {
+        FlipRun run;
+        run.first = run.last = first + i;
+        run.count = 1;
+        run.accepted = accepted;
+        runs.append(run);
+        open = true;
+      }
+    }
+
+    // Runs in order.  Each brings the rank up to date before its signal
+    //   ends: words within the run are recounted, and those after it only
+    //   shift by the run's size.
+    for (int r = 0; r < runs.size(); r++)
+    {
+      const FlipRun &run = runs.at(r);
+      int proxyRow = acceptedBefore(run.first);
+      if (run.accepted)
+        beginInsertRows(QModelIndex(), proxyRow, proxyRow + run.count - 1);
+      else
+        beginRemoveRows(QModelIndex(), proxyRow, proxyRow + run.count - 1);
+
+      for (int row = run.first; row <= run.last; row++)
+      {
+        int i = row - first;
+        if (((outcome.at(i >> 6) >> (i & 63)) & 1) != isAccepted(row))
+          bits[row >> 6] ^= quint64(1) << (row & 63);
+      }
+
+      int lastWord = run.last >> 6;
+      for (int w = run.first >> 6; w < lastWord; w++)
+        rank[w + 1] = rank.at(w) + qPopulationCount(bits.at(w));
+      int shift = run.accepted ? run.count : -run.count;
+      for (int w = lastWord + 1; w < rank.size(); w++)
+        rank[w] += shift;
+
+      if (run.accepted)
+        endInsertRows();
+      else
+        endRemoveRows();
+    }
+  }
+
+  int top = acceptedBefore(first), bottom = acceptedBefore(last + 1) - 1;
+  if (bottom >= top)
+    emit dataChanged(index(top, topLeft.column()),
+                     index(bottom, bottomRight.column()));
+}
+
+/*
+ * Method: sourceRowsInserted
+ */
+void RowFilterProxyModel::sourceRowsInserted(const QModelIndex &parent,
+                                             int first, int last)
+{
+  if (parent.isValid())
+    return;
+
+  if (!rowFilter.isActive())
+  {
+    beginInsertRows(QModelIndex(), first, last);
+    endInsertRows();
+    return;
+  }
+
+  // Evaluate the new rows on their own, then splice their bits in.
+  int count = last - first + 1;
+  QVector<double> xs(count), ys(count);
+  model->xColumn().read(first, count, xs.data());
+  model->yColumn().read(first, count, ys.data());
+
+  QVector<quint64> inserted((count + 63) / 64, 0);
+  int accepted = 0;
+  for (int i = 0; i < count; i += 64)
+  {
+    quint64 word = evaluateGroup(rowFilter, xs.constData() + i,
+                                 ys.constData() + i, qMin(64, count - i));
+    inserted[i >> 6] = word;
+    accepted += qPopulationCount(word);
+  }
+
+  int proxyFirst = acceptedBefore(first);
+  if (accepted > 0)
+    beginInsertRows(QModelIndex(), proxyFirst, proxyFirst + accepted - 1);
+
+  int rows = model->rowCount();
+  if (last == rows - 1)
+  {
+    // Appending needs no shift.
+    bits.resize((rows + 63) / 64);
+    copyBits(bits.data(), first, inserted, 0, count);
+  }
+  else
+  {
+    QVector<quint64> spliced((rows + 63) / 64, 0);
+    copyBits(spliced.data(), 0, bits, 0, first);
+    copyBits(spliced.data(), first, inserted, 0, count);
+    copyBits(spliced.data(), last + 1, bits, first, rows - last - 1);
+    bits = spliced;
+  }
+  rebuildRank(first >> 6);
+
+  if (accepted > 0)
+    endInsertRows();
+}
+
+/*
+ * Method: sourceRowsAboutToBeRemoved
+ */
+void RowFilterProxyModel::sourceRowsAboutToBeRemoved(const QModelIndex &parent,
+                                                     int first, int last)
+{
+  if (parent.isValid())
+    return;
+
+  // Accepted rows of the range are contiguous in the proxy.
+  int top = acceptedBefore(first), bottom = acceptedBefore(last + 1) - 1;
+  if (bottom >= top)
+  {
+    beginRemoveRows(QModelIndex(), top, bottom);
+    removing = true;
+  }
+}
+
+/*
+ * Method: sourceRowsRemoved
+ */
+void RowFilterProxyModel::sourceRowsRemoved(const QModelIndex &parent,
+                                            int first, int last)
+{
+  if (parent.isValid())
+    return;
+
+  if (rowFilter.isActive())
+  {
+    int rows = model->rowCount();
+    QVector<quint64> spliced((rows + 63) / 64, 0);
+    copyBits(spliced.data(), 0, bits, 0, first);
+    copyBits(spliced.data(), first, bits, last + 1, rows - first);
+    bits = spliced;
+    rebuildRank(first >> 6);
+  }
+
+  if (removing)
+  {
+    removing = false;
+    endRemoveRows();
+  }
+}
+
+/*
+ * Method: sourceAboutToBeReset
+ */
+void RowFilterProxyModel::sourceAboutToBeReset()
+{
+  beginResetModel();
+}
+
+/*
+ * Method: sourceReset
+ */
+void RowFilterProxyModel::sourceReset()
+{
+  evaluateAll();
+  endResetModel();
+}
+
+/*
+ * Method: sourceHeaderDataChanged
+ */
+void RowFilterProxyModel::sourceHeaderDataChanged(Qt::Orientation orientation,
+                                                  int first, int last)
+{
+  if (orientation == Qt::Horizontal)
+    emit headerDataChanged(orientation, first, last);
+}
+
+/*
+ * Method: evaluateAll
+ */
+void RowFilterProxyModel::evaluateAll()
+{
+  int rows = model ? model->rowCount() : 0;
+  bits.clear();
+  rank.clear();
+  if (!rowFilter.isActive())
+    return;
+
+  bits.fill(0, (rows + 63) / 64);
+
+  // Group blocks into tasks of at least TaskRows rows.
+  const DataColumn &xColumn = model->xColumn();
+  QVector<Task> tasks;
+  for (int b = 0; b < xColumn.blockCount(); b++)
+  {
+    if (!tasks.isEmpty() &&
+        (xColumn.blockStart(b) -
+         xColumn.blockStart(tasks.last().firstBlock) < TaskRows))
+    {
+      tasks.last().lastBlock = b;
+    }
+    else
+    {
+      Task task;
+      task.firstBlock = task.lastBlock = b;
+      task.firstWord = 0;
+      tasks.append(task);
+    }
+  }
+  QtConcurrent::blockingMap(tasks, [this](Task &task) { evaluate(task); });
+
+  // Tasks may share a word where they meet.
+  for (int t = 0; t < tasks.size(); t++)
+  {
+    const Task &task = tasks.at(t);
+    for (int i = 0; i < task.words.size(); i++)
+      bits[task.firstWord + i] |= task.words.at(i);
+  }
+  rebuildRank(0);
+}
+
+/*
+ * Method: evaluate
+ */
+void RowFilterProxyModel::evaluate(Task &task) const
+{
+  const DataColumn &xColumn = model->xColumn();
+  const DataColumn &yColumn = model->yColumn();
+  int first = xColumn.blockStart(task.firstBlock);
+  int end = xColumn.blockStart(task.lastBlock) +
+      xColumn.blockLength(task.lastBlock);
+  task.firstWord = first >> 6;
+  task.words.fill(0, ((end - 1) >> 6) - task.firstWord + 1);
+
+  QVector<double> xScratch(DataColumn::MaxBlockSize);
+  QVector<double> yScratch(DataColumn::MaxBlockSize);
+  for (int b = task.firstBlock; b <= task.lastBlock; b++)
+  {
+    int start = xColumn.blockStart(b);
+    int length = xColumn.blockLength(b);
+    const double *xs = xColumn.blockData(b, xScratch.data());
+    const double *ys = yScratch.constData();
+    if ((b < yColumn.blockCount()) && (yColumn.blockStart(b) == start) &&
+        (yColumn.blockLength(b) == length))
+      ys = yColumn.blockData(b, yScratch.data());
+    else
+      yColumn.read(start, length, yScratch.data());
+
+    int position = start - task.firstWord * 64;
+    for (int i = 0; i < length; i += 64)
+      orWord(task.words.data(), position + i,
+             evaluateGroup(rowFilter, xs + i, ys + i, qMin(64, length - i)));
+  }
+}
+
+/*
+ * Method: rebuildRank
+ */
+void RowFilterProxyModel::rebuildRank(int fromWord)
+{
+  fromWord = qMin(fromWord, qMin(bits.size(), rank.size() - 1));
+  if (fromWord < 0)
+    fromWord = 0;
+  rank.resize(bits.size() + 1);
+  if (fromWord == 0)
+    rank[0] = 0;
+
+  for (int w = fromWord; w < bits.size(); w++)
+    rank[w + 1] = rank.at(w) + qPopulationCount(bits.at(w));
+}
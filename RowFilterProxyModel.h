@@ -0,0 +1,255 @@
+/*
+ * RowFilterProxyModel.h: Proxy model showing the rows of a CSVDataModel that
+ *                      : pass simple range and threshold predicates.
+ * Author: B. D. Knopp: bdknopp@users.noreply.github.com
+ * Version: 1.00: Initial implementation.
+ * Date: 19 October 2026
+ */
+
+#ifndef ROWFILTERPROXYMODEL_H
+#define ROWFILTERPROXYMODEL_H
+
+/* Qt includes. */
+#include <QAbstractProxyModel>
+#include <QVector>
+
+/* Project includes. */
+#include "CSVDataModel.h"
+
+/*
+ * Struct: RowFilter
+ * Description: Predicates a row must pass to be shown; all enabled
+ *            : predicates must hold.  Comparisons with empty (NaN) cells
+ *            : always fail.
+ */
+struct RowFilter
+{
+  /*
+   * Enum: EmptyCells
+   * Description: Treatment of rows with an empty X or Y cell.
+   */
+  enum EmptyCells { AnyCells, HideEmpty, OnlyEmpty };
+
+  RowFilter() :
+    xRange(false), xMinimum(0.0), xMaximum(0.0),
+    yAbove(false), yMinimum(0.0),
+    yBelow(false), yMaximum(0.0),
+    emptyCells(AnyCells)
+  {
+  }
+
+  /*
+   * Method: isActive
+   * Description: Determines if any predicate is enabled.
+   * Parameters: none.
+   * Returns: True if rows may be hidden; false otherwise.
+   */
+  bool isActive() const
+  {
+    return xRange || yAbove || yBelow || (emptyCells != AnyCells);
+  }
+
+  // xMinimum <= X <= xMaximum; Y > yMinimum; Y < yMaximum.
+  bool xRange;
+  double xMinimum, xMaximum;
+  bool yAbove;
+  double yMinimum;
+  bool yBelow;
+  double yMaximum;
+  EmptyCells emptyCells;
+};
+
+/*
+ * Class: RowFilterProxyModel
+ * Description: Filters the rows of a CSVDataModel without per-row QVariant
+ *            : calls.  The filter is evaluated over the column blocks, two
+ *            : rows per SSE2 instruction, into a bitmap of accepted rows; a
+ *            : count of accepted rows before each 64-row word maps rows both
+ *            : ways in constant or logarithmic time.  Edits re-evaluate only
+ *            : the rows changed.
+ */
+class RowFilterProxyModel : public QAbstractProxyModel
+{
+  Q_OBJECT
+
+  /* Public types. */
+  public:
+    // Rows evaluated per parallel task, at least.
+    static const int TaskRows = 1 << 20;
+
+    // Edits to more rows than this re-evaluate the filter and reset.
+    static const int RescanRows = 65536;
+
+  /* Public methods. */
+  public:
+    /*
+     * Constructor: RowFilterProxyModel
+     * Description: Creates a proxy with no source and no filter.
+     * Parameters: parent: Parent object to associate with; default 0.
+     */
+    explicit RowFilterProxyModel(QObject *parent = 0);
+
+    /*
+     * Method: setSourceModel
+     * Description: Sets the model to filter, which must be a CSVDataModel.
+     * Parameters: sourceModel: Model to filter.
+     * Returns: none.
+     */
+    void setSourceModel(QAbstractItemModel *sourceModel);
+
+    /*
+     * Method: dataModel
+     * Description: Retrieves the model filtered.
+     * Parameters: none.
+     * Returns: Source model; 0 if none.
+     */
+    CSVDataModel *dataModel() const { return model; }
+
+    /*
+     * Method: setFilter
+     * Description: Replaces the filter and re-evaluates every row.
+     * Parameters: filter: Predicates to apply.
+     * Returns: none.
+     */
+    void setFilter(const RowFilter &filter);
+
+    /*
+     * Method: filter
+     * Description: Retrieves the filter applied.
+     * Parameters: none.
+     * Returns: Predicates applied.
+     */
+    const RowFilter &filter() const { return rowFilter; }
+
+    /*
+     * Method: isAccepted
+     * Description: Determines if a source row passes the filter.
+     * Parameters: sourceRow: Row of source model.
+     * Returns: True if the row is shown; false otherwise.
+     */
+    bool isAccepted(int sourceRow) const
+    {
+      return !rowFilter.isActive() ||
+          ((bits.at(sourceRow >> 6) >> (sourceRow & 63)) & 1);
+    }
+
+    /*
+     * Method: acceptedBefore
+     * Description: Counts the accepted source rows before a source row.
+     * Parameters: sourceRow: Row of source model; may be the row count.
+     * Returns: Number of accepted rows, which is also the proxy row of
+     *        : sourceRow if it is accepted.
+     */
+    int acceptedBefore(int sourceRow) const;
+
+    /*
+     * Methods: mapToSource, mapFromSource
+     * Description: Maps indices between the proxy and source model.
+     * Parameters: proxyIndex, sourceIndex: Index to map.
+     * Returns: Mapped index; invalid if the source row is filtered out.
+     */
+    QModelIndex mapToSource(const QModelIndex &proxyIndex) const;
+    QModelIndex mapFromSource(const QModelIndex &sourceIndex) const;
+
+    /*
+     * Methods: index, parent
+     * Description: Creates indices of the flat proxy table.
+     * Parameters: row, column: Cell position.
+     *           : parent, child: Parent or child index.
+     * Returns: Index; parents are always invalid.
+     */
+    QModelIndex index(int row, int column,
+                      const QModelIndex &parent = QModelIndex()) const;
+    QModelIndex parent(const QModelIndex &child) const;
+
+    /*
+     * Methods: rowCount, columnCount
+     * Description: Retrieves the dimensions of the filtered table.
+     * Parameters: parent: Parent index; must be invalid.
+     * Returns: Number of accepted rows, or columns.
+     */
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+
+  /* Private types. */
+  private:
+    // Consecutive blocks evaluated together, and their bitmap words.
+    struct Task
+    {
+      int firstBlock, lastBlock;
+      int firstWord;
+      QVector<quint64> words;
+    };
+
+    // Edited rows whose outcome changed the same way, adjacent in the proxy.
+    struct FlipRun
+    {
+      int first, last;
+      int count;
+      bool accepted;
+    };
+
+  /* Private slots. */
+  private slots:
+    /*
+     * Methods: sourceDataChanged, sourceRowsInserted,
+     *        : sourceRowsAboutToBeRemoved, sourceRowsRemoved,
+     *        : sourceAboutToBeReset, sourceReset, sourceHeaderDataChanged
+     * Description: Update the bitmap and forward source model changes.
+     * Parameters: topLeft, bottomRight: Range of edited cells.
+     *           : parent: Parent index.
+     *           : first, last: Range of rows inserted or removed.
+     *           : orientation: Header orientation.
+     * Returns: none.
+     */
+    void sourceDataChanged(const QModelIndex &topLeft,
+                           const QModelIndex &bottomRight);
+    void sourceRowsInserted(const QModelIndex &parent, int first, int last);
+    void sourceRowsAboutToBeRemoved(const QModelIndex &parent, int first,
+                                    int last);
+    void sourceRowsRemoved(const QModelIndex &parent, int first, int last);
+    void sourceAboutToBeReset();
+    void sourceReset();
+    void sourceHeaderDataChanged(Qt::Orientation orientation, int first,
+                                 int last);
+
+  /* Private members. */
+  private:
+    /*
+     * Method: evaluateAll
+     * Description: Evaluates the filter over every row, in parallel tasks,
+     *            : and rebuilds the rank index.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void evaluateAll();
+
+    /*
+     * Method: evaluate
+     * Description: Evaluates the filter over a task's blocks.  Reads the
+     *            : columns only, so tasks may run concurrently.
+     * Parameters: task: Task to evaluate; receives its bitmap words.
+     * Returns: none.
+     */
+    void evaluate(Task &task) const;
+
+    /*
+     * Method: rebuildRank
+     * Description: Recomputes accepted-row counts from a word onwards.
+     * Parameters: fromWord: First word whose count may have changed.
+     * Returns: none.
+     */
+    void rebuildRank(int fromWord);
+
+    CSVDataModel *model;
+    RowFilter rowFilter;
+
+    // Bit per source row; accepted rows before each word, plus the total.
+    QVector<quint64> bits;
+    QVector<int> rank;
+
+    // Whether a removal announced to views is in progress.
+    bool removing;
+};
+
+#endif // ROWFILTERPROXYMODEL_H
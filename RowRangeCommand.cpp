@@ -0,0 +1,76 @@
+/*
+ * RowRangeCommand.cpp: See "RowRangeCommand.h" for documentation.
+ */
+
+#include "RowRangeCommand.h"
+
+/* Qt includes. */
+#include <QObject>
+
+/*
+ * Constructor: RowRangeCommand
+ */
+RowRangeCommand::RowRangeCommand(CSVDataModel *model, Operation operation,
+                                 const QVector<DataColumn::RowRange> &ranges,
+                                 QUndoCommand *parent) :
+  QUndoCommand(parent),
+  model(model),
+  operation(operation),
+  ranges(ranges)
+{
+  int rows = 0;
+  for (int i = 0; i < ranges.size(); i++)
+    rows += ranges.at(i).count;
+
+  if (operation == Insert)
+    setText(QObject::tr("add %n row(s)", 0, rows));
+  else
+    setText(QObject::tr("delete %n row(s)", 0, rows));
+}
+
+/*
+ * Method: undo
+ */
+void RowRangeCommand::undo()
+{
+  if (operation == Insert)
+    remove();
+  else
+    insert();
+}
+
+/*
+ * Method: redo
+ */
+void RowRangeCommand::redo()
+{
+  if (operation == Insert)
+    insert();
+  else
+    remove();
+}
+
+/*
+ * Method: insert
+ */
+void RowRangeCommand::insert()
+{
+  if (xs.isEmpty())
+  {
+    model->insertRowRanges(ranges);
+  }
+  else
+  {
+    model->insertRowRanges(ranges, xs.constData(), ys.constData());
+    xs = QVector<double>();
+    ys = QVector<double>();
+  }
+}
+
+/*
+ * Method: remove
+ */
+void RowRangeCommand::remove()
+{
+  model->removeRowRanges(ranges, &xs, &ys);
+}
@@ -0,0 +1,82 @@
+/*
+ * RowRangeCommand.h: Undoable insertion or removal of runs of rows.
+ * Author: B. D. Knopp: bdknopp@users.noreply.github.com
+ * Version: 1.00: Initial implementation.
+ * Date: 19 October 2026
+ */
+
+#ifndef ROWRANGECOMMAND_H
+#define ROWRANGECOMMAND_H
+
+/* Qt includes. */
+#include <QUndoCommand>
+#include <QVector>
+
+/* Project includes. */
+#include "CSVDataModel.h"
+#include "DataColumn.h"
+
+/*
+ * Class: RowRangeCommand
+ * Description: Inserts or removes runs of rows of a CSVDataModel as one
+ *            : step of an undo stack.  Only the runs are recorded, plus
+ *            : the values of the rows while they are removed, so a step
+ *            : costs memory in proportion to the rows it affects rather
+ *            : than to the data set.
+ */
+class RowRangeCommand : public QUndoCommand
+{
+  /* Public types. */
+  public:
+    /*
+     * Enum: Operation
+     * Description: Effect of the command when done (redone).
+     */
+    enum Operation { Insert, Remove };
+
+  /* Public methods. */
+  public:
+    /*
+     * Constructor: RowRangeCommand
+     * Description: Creates a command; the operation is performed when the
+     *            : command is pushed onto an undo stack.
+     * Parameters: model: Model to edit.
+     *           : operation: Whether to insert empty rows or remove rows.
+     *           : ranges: Disjoint runs in ascending order; for Insert, the
+     *           :       : rows they occupy once inserted.
+     *           : parent: Parent command; default 0.
+     */
+    RowRangeCommand(CSVDataModel *model, Operation operation,
+                    const QVector<DataColumn::RowRange> &ranges,
+                    QUndoCommand *parent = 0);
+
+    /*
+     * Methods: undo, redo
+     * Description: Revert or perform the operation.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void undo();
+    void redo();
+
+  /* Private members. */
+  private:
+    /*
+     * Methods: insert, remove
+     * Description: Insert the runs, with their recorded values if any, or
+     *            : remove them, recording their values.
+     * Parameters: none.
+     * Returns: none.
+     */
+    void insert();
+    void remove();
+
+    CSVDataModel *model;
+    Operation operation;
+    QVector<DataColumn::RowRange> ranges;
+
+    // Values of the rows while removed; empty while they are in the model.
+    QVector<double> xs, ys;
+};
+
+#endif // ROWRANGECOMMAND_H
@@ -0,0 +1,288 @@
+/*
+ * TimestampParser.cpp: See "TimestampParser.h" for documentation.
+ */
+
+#include "TimestampParser.h"
+#include "CSVParser.h"
+
+/* C includes. */
+#include <cmath>
+#include <limits>
+
+/* Qt includes. */
+#include <QDateTime>
+
+// Powers of ten usable as exact fraction scales.
+static const qint64 fractionScales[] = {
+  1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL,
+  100000000LL, 1000000000LL
+};
+
+/*
+ * Procedure: readDigits
+ * Description: Reads a fixed number of decimal digits.
+ * Parameters: p: Input position; advanced past the digits.
+ *           : end: End of input.
+ *           : count: Number of digits required.
+ *           : value: Receives the value read.
+ * Returns: True if count digits were present; false otherwise.
+ */
+static inline bool readDigits(const char *&p, const char *end, int count,
+                              int *value)
+{
+  if (end - p < count)
+    return false;
+
+  int result = 0;
+  for (int i = 0; i < count; i++)
+  {
+    if ((p[i] < '0') || (p[i] > '9'))
+      return false;
+    result = result * 10 + (p[i] - '0');
+  }
+  p += count;
+  *value = result;
+  return true;
+}
+
+/*
+ * Procedure: daysFromCivil
+ * Description: Counts days from 1970-01-01 to a proleptic Gregorian date.
+ * Parameters: year, month, day: Date.
+ * Returns: Day number; negative before the epoch.
+ */
+static inline qint64 daysFromCivil(int year, int month, int day)
+{
+  year -= (month <= 2);
+  qint64 era = ((year >= 0) ? year : (year - 399)) / 400;
+  qint64 yearOfEra = year - era * 400;
+  qint64 dayOfYear = (153 * (month + ((month > 2) ? -3 : 9)) + 2) / 5 +
+      day - 1;
+  qint64 dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 +
+      dayOfYear;
+  return era * 146097 + dayOfEra - 719468;
+}
+
+/*
+ * Procedure: daysInMonth
+ * Description: Determines the length of a month.
+ * Parameters: year, month: Month to measure.
+ * Returns: Number of days.
+ */
+static inline int daysInMonth(int year, int month)
+{
+  static const int lengths[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30,
+                                 31 };
+  bool leap = ((year % 4) == 0) && (((year % 100) != 0) || ((year % 400) == 0));
+  return ((month == 2) && leap) ? 29 : lengths[month - 1];
+}
+
+/*
+ * Method: parseIso8601
+ */
+bool TimestampParser::parseIso8601(const char *begin, const char *end,
+                                   double *seconds)
+{
+  while ((begin < end) && ((*begin == ' ') || (*begin == '\t')))
+    begin++;
+  while ((end > begin) && ((end[-1] == ' ') || (end[-1] == '\t')))
+    end--;
+
+  // Date: YYYY-MM-DD.
+  const char *p = begin;
+  int year, month, day;
+  if (!readDigits(p, end, 4, &year) || (p == end) || (*p++ != '-') ||
+      !readDigits(p, end, 2, &month) || (p == end) || (*p++ != '-') ||
+      !readDigits(p, end, 2, &day))
+    return false;
+  if ((month < 1) || (month > 12) || (day < 1) ||
+      (day > daysInMonth(year, month)))
+    return false;
+
+  // Time: Thh:mm[:ss[.fff]].
+  int hour = 0, minute = 0, second = 0;
+  qint64 fraction = 0;
+  int fractionDigits = 0;
+  if ((p < end) && ((*p == 'T') || (*p == ' ')))
+  {
+    p++;
+    if (!readDigits(p, end, 2, &hour) || (p == end) || (*p++ != ':') ||
+        !readDigits(p, end, 2, &minute))
+      return false;
+
+    if ((p < end) && (*p == ':'))
+    {
+      p++;
+      if (!readDigits(p, end, 2, &second))
+        return false;
+
+      if ((p < end) && ((*p == '.') || (*p == ',')))
+      {
+        p++;
+        const char *digits = p;
+        while ((p < end) && (*p >= '0') && (*p <= '9'))
+        {
+          // Digits beyond nanoseconds cannot be represented anyway.
+          if (fractionDigits < 9)
+          {
+            fraction = fraction * 10 + (*p - '0');
+            fractionDigits++;
+          }
+          p++;
+        }
+        if (p == digits)
+          return false;
+      }
+    }
+    if ((hour > 23) || (minute > 59) || (second > 60))
+      return false;
+  }
+
+  // Offset: Z, +hh:mm, +hhmm or +hh.
+  int offsetMinutes = 0;
+  if (p < end)
+  {
+    if (*p == 'Z')
+    {
+      p++;
+    }
+    else if ((*p == '+') || (*p == '-'))
+    {
+      int sign = (*p++ == '-') ? -1 : 1;
+      int offsetHours, offsetMins = 0;
+      if (!readDigits(p, end, 2, &offsetHours))
+        return false;
+      // Minutes are optional, but a colon must be followed by them.
+      bool sawColon = (p < end) && (*p == ':');
+      if (sawColon)
+        p++;
+      if ((sawColon || (p < end)) && !readDigits(p, end, 2, &offsetMins))
+        return false;
+      if ((offsetHours > 23) || (offsetMins > 59))
+        return false;
+      offsetMinutes = sign * (offsetHours * 60 + offsetMins);
+    }
+  }
+  if (p != end)
+    return false;
+
+  qint64 whole = daysFromCivil(year, month, day) * 86400 + hour * 3600 +
+      minute * 60 + second - offsetMinutes * 60;
+  // Whole and fraction combine exactly while the scaled count fits, up to
+  //   the year 2262 for nanoseconds; beyond, the fraction is added apart.
+  qint64 scale = fractionScales[fractionDigits];
+  if (qAbs(whole) <= (std::numeric_limits<qint64>::max() - scale) / scale)
+    *seconds = double(whole * scale + fraction) / double(scale);
+  else
+    *seconds = double(whole) + double(fraction) / double(scale);
+  return true;
+}
+
+/*
+ * Method: parse
+ */
+bool TimestampParser::parse(Format format, const char *begin,
+                            const char *end, double *value)
+{
+  switch (format)
+  {
+    case Iso8601:
+      return parseIso8601(begin, end, value);
+    case EpochMilliseconds:
+      if (!CSVParser::parseNumber(begin, end, value))
+        return false;
+      *value /= 1000.0;
+      return true;
+    default:
+      return CSVParser::parseNumber(begin, end, value);
+  }
+}
+
+/*
+ * Method: detectFormat
+ */
+TimestampParser::Format TimestampParser::detectFormat(const QString &label,
+                                                      const char *begin,
+                                                      const char *end)
+{
+  double value;
+  if (parseIso8601(begin, end, &value))
+    return Iso8601;
+
+  if (!CSVParser::parseNumber(begin, end, &value))
+    return None;
+
+  QString name = label.trimmed().toLower();
+  bool timeLabel = name.contains("time") || name.contains("date") ||
+      name.contains("epoch") || (name == "ts");
+  if (!timeLabel)
+    return None;
+
+  // 1e8 s is 1973; 1e11 ms is 1973; 1e14 ms is 5138.
+  double magnitude = std::fabs(value);
+  if ((magnitude >= 1e11) && (magnitude < 1e14))
+    return EpochMilliseconds;
+  if ((magnitude >= 1e8) && (magnitude < 1e11))
+    return EpochSeconds;
+  return None;
+}
+
+/*
+ * Method: toText
+ */
+QString TimestampParser::toText(double seconds)
+{
+  if (!std::isfinite(seconds))
+    return QString();
+
+  // Microseconds are about as fine as a double resolves present-day
+  //   times, and enough that text written and read back keeps its value.
+  double whole = std::floor(seconds);
+  qint64 microseconds = qint64(std::floor((seconds - whole) * 1e6 + 0.5));
+  if (microseconds >= 1000000)
+  {
+    whole += 1.0;
+    microseconds -= 1000000;
+  }
+
+  QDateTime time = QDateTime::fromMSecsSinceEpoch(qint64(whole) * 1000,
+                                                  Qt::UTC);
+  QString text = time.toString("yyyy-MM-dd'T'HH:mm:ss");
+  if (microseconds % 1000)
+    text += QString(".%1").arg(microseconds, 6, 10, QChar('0'));
+  else if (microseconds)
+    text += QString(".%1").arg(microseconds / 1000, 3, 10, QChar('0'));
+  return text + "Z";
+}
+
+/*
+ * Method: durationText
+ */
+QString TimestampParser::durationText(double seconds)
+{
+  double span = std::fabs(seconds);
+  if (span < 1.0)
+    return QString::number(span * 1000.0, 'g', 3) + "ms";
+  if (span < 60.0)
+    return QString::number(span, 'g', 3) + "s";
+
+  // Two most significant units.
+  static const char *const names[] = { "d", "h", "m", "s" };
+  static const double sizes[] = { 86400.0, 3600.0, 60.0, 1.0 };
+  QString text;
+  int shown = 0;
+  qint64 remaining = qint64(span + 0.5);
+  for (int i = 0; (i < 4) && (shown < 2); i++)
+  {
+    qint64 count = remaining / qint64(sizes[i]);
+    remaining -= count * qint64(sizes[i]);
+    if ((count > 0) || (shown > 0))
+    {
+      if (!text.isEmpty())
+        text += " ";
+      text += QString::number(count) + names[i];
+      shown++;
+    }
+  }
+  return text;
+}
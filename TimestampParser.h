@@ -0,0 +1,94 @@
+/*
+ * TimestampParser.h: Allocation-free conversion of ISO-8601 and epoch
+ *                  : timestamps to numeric X values.
+ * Author: B. D. Knopp: bdknopp@users.noreply.github.com
+ * Version: 1.00: Initial implementation.
+ * Date: 19 October 2026
+ */
+
+#ifndef TIMESTAMPPARSER_H
+#define TIMESTAMPPARSER_H
+
+/* Qt includes. */
+#include <QString>
+
+/*
+ * Class: TimestampParser
+ * Description: Converts timestamps to seconds since the Unix epoch (UTC),
+ *            : and back to text.  Parsing works directly on file bytes and
+ *            : accepts the fixed layout "YYYY-MM-DD[Thh:mm[:ss[.f]]][offset]",
+ *            : where the separator may also be a space, the fraction has
+ *            : any number of digits, and the offset is "Z", "+hh:mm",
+ *            : "+hhmm" or "+hh".  Times without an offset are taken as UTC.
+ */
+class TimestampParser
+{
+  /* Public types. */
+  public:
+    /*
+     * Enum: Format
+     * Description: How timestamps of an X column are written in the file.
+     */
+    enum Format { None, Iso8601, EpochSeconds, EpochMilliseconds };
+
+  /* Public methods. */
+  public:
+    /*
+     * Method: parseIso8601
+     * Description: Converts an ISO-8601 timestamp.  Fractional seconds are
+     *            : combined as an integer count of units over a power of
+     *            : ten, so millisecond and microsecond data stays exactly
+     *            : reproducible from scaled integers.
+     * Parameters: begin, end: Text to convert; surrounding blanks ignored.
+     *           : seconds: Receives seconds since the epoch.
+     * Returns: True if the text was a valid timestamp; false otherwise.
+     */
+    static bool parseIso8601(const char *begin, const char *end,
+                             double *seconds);
+
+    /*
+     * Method: parse
+     * Description: Converts an X value written in the given format.
+     * Parameters: format: Format of the X column.
+     *           : begin, end: Text to convert.
+     *           : value: Receives the value; seconds since the epoch for
+     *           :      : timestamp formats.
+     * Returns: True if the text was valid; false otherwise.
+     */
+    static bool parse(Format format, const char *begin, const char *end,
+                      double *value);
+
+    /*
+     * Method: detectFormat
+     * Description: Guesses the timestamp format of an X column from its
+     *            : label and first valid value.  Numbers are only taken as
+     *            : epoch times if the label names a time and the magnitude
+     *            : fits.
+     * Parameters: label: X column label.
+     *           : begin, end: Text of the first valid X value.
+     * Returns: Detected format; None for plain numbers.
+     */
+    static Format detectFormat(const QString &label, const char *begin,
+                               const char *end);
+
+    /*
+     * Method: toText
+     * Description: Formats seconds since the epoch as an ISO-8601 UTC
+     *            : timestamp, with milliseconds or microseconds when
+     *            : non-zero; text parsed back gives the same value for
+     *            : times given to the microsecond.
+     * Parameters: seconds: Time to format.
+     * Returns: Timestamp text.
+     */
+    static QString toText(double seconds);
+
+    /*
+     * Method: durationText
+     * Description: Formats a time span compactly, e.g. "1h 30m" or "250ms".
+     * Parameters: seconds: Span to format.
+     * Returns: Duration text.
+     */
+    static QString durationText(double seconds);
+};
+
+#endif // TIMESTAMPPARSER_H
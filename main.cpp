@@ -6,22 +6,55 @@
  */
 
 /* Project includes. */
+#include "CSVParser.h"
 #include "MainWindow.h"
 
 /* Qt includes. */
 #include <QApplication>
+#include <QFuture>
+#include <QStringList>
+#include <QtConcurrent>
 
 /*
  * Procedure: main
- * Description: Initializes GUI view.
- * Parameters: argc: Argument count; unused.
- *           : argv: Argument vector; unused.
+ * Description: Initializes GUI view.  A file named on the command line is
+ *            : parsed on a worker thread started before the window is set
+ *            : up, so that reading it overlaps window setup.
+ * Parameters: argc: Argument count.
+ *           : argv: Argument vector; optionally a CSV file to open, among
+ *           :     : Qt's own options.
  * Returns: 0 if terminated cleanly.
  */
 int main(int argc, char *argv[])
 {
+  // Qt removes the options it recognises, with their values; the file is
+  //   the first argument left that is not an option.
   QApplication a(argc, argv);
+  QStringList arguments = a.arguments();
+  QString fName;
+  bool options = true;
+  for (int i = 1; (i < arguments.size()) && fName.isEmpty(); i++)
+  {
+    if (options && (arguments.at(i) == "--"))
+      options = false;
+    else if (!options || !arguments.at(i).startsWith('-'))
+      fName = arguments.at(i);
+  }
+
+  QFuture<CSVDataSet> pending;
+  if (!fName.isEmpty())
+    pending = QtConcurrent::run(&CSVParser::parseFile, fName, false,
+                                CSVParser::FillNaN);
+
   MainWindow w;
+  if (!fName.isEmpty())
+  {
+    w.openPendingFile(fName, pending);
+
+    // The window's watcher is left holding the only reference to the
+    //   result, so that the data set can be freed once closed or spilled.
+    pending = QFuture<CSVDataSet>();
+  }
   w.show();
 
   return a.exec();